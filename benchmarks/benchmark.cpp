@@ -0,0 +1,739 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <sys/resource.h>
+#endif
+
+#include "pointquadtree.hpp"
+#include "quadtree.hpp"
+
+/* Runs a set of quadtree workloads and prints one JSON object per workload, one per line.
+ *
+ * Usage: quadtree_benchmark [--colliders N] [--frames N] [--queries N] [--max-divisions N] [--max-elements N]
+ *     [--threads N] [--grid-depth N] [--seed N] [--workload NAME]
+ *
+ * The thread count applies to the rebuild workload, and zero uses the hardware concurrency. A non-zero grid
+ * depth starts every descent from a grid of nodes at that depth. */
+
+namespace
+{
+    const int WORLD_SIZE = 1 << 16;
+
+    /* Settings shared by every workload. */
+    struct Settings
+    {
+        int numColliders = 20000;
+        int numFrames = 20;
+        int numQueries = 20000;
+        int maxDivisions = 8;
+        int maxEltsPerNode = 16;
+        int numThreads = 1;
+        int gridDepth = 0;
+        unsigned int seed = 1;
+        std::string workload;
+    };
+
+    /* The measurements taken by a single workload. */
+    struct Result
+    {
+        const char* name;
+        const char* operation;
+        long long operations;
+        double seconds;
+        int quadNodes, quadNodeCapacity, elementNodes, elementNodeCapacity;
+    };
+
+    /* Returns the peak resident set size of the process so far in kilobytes, or -1 where it is not available. */
+    long long peakMemoryKilobytes()
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        struct rusage usage;
+
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return -1;
+
+    #if defined(__APPLE__)
+        return (long long)usage.ru_maxrss / 1024;
+    #else
+        return (long long)usage.ru_maxrss;
+    #endif
+#else
+        return -1;
+#endif
+    }
+
+    /* Returns the number of seconds taken by the function. */
+    double timeSeconds(const std::function<void()>& function)
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        function();
+
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /* Returns a box of the given size centred on the point, clamped to the world. */
+    QuadTreeCollider<> makeBox(double x, double y, int width, int height)
+    {
+        const int left = std::min(std::max((int)x - width / 2, 0), WORLD_SIZE - 1 - width),
+            bottom = std::min(std::max((int)y - height / 2, 0), WORLD_SIZE - 1 - height);
+
+        return QuadTreeCollider<>(bottom + height, bottom, left, left + width);
+    }
+
+    /* Small boxes spread evenly across the world. */
+    std::vector<QuadTreeCollider<>> uniformBoxes(int count, std::mt19937* random)
+    {
+        std::uniform_real_distribution<double> position(0.0, WORLD_SIZE);
+        std::uniform_int_distribution<int> size(16, 256);
+        std::vector<QuadTreeCollider<>> boxes;
+
+        for (int i = 0; i < count; i++)
+            boxes.push_back(makeBox(position(*random), position(*random), size(*random), size(*random)));
+
+        return boxes;
+    }
+
+    /* Small boxes gathered in a few dense Gaussian crowds. */
+    std::vector<QuadTreeCollider<>> clusteredBoxes(int count, std::mt19937* random)
+    {
+        std::uniform_real_distribution<double> centre(WORLD_SIZE * 0.1, WORLD_SIZE * 0.9);
+        std::normal_distribution<double> spread(0.0, WORLD_SIZE * 0.02);
+        std::uniform_int_distribution<int> size(16, 128);
+        std::vector<QuadTreeCollider<>> boxes;
+
+        const int numClusters = 8;
+        double centresX[numClusters], centresY[numClusters];
+
+        for (int i = 0; i < numClusters; i++)
+        {
+            centresX[i] = centre(*random);
+            centresY[i] = centre(*random);
+        }
+
+        for (int i = 0; i < count; i++)
+            boxes.push_back(makeBox(centresX[i % numClusters] + spread(*random), centresY[i % numClusters] + spread(*random),
+                size(*random), size(*random)));
+
+        return boxes;
+    }
+
+    /* Mostly small boxes with one in twenty spanning a large part of the world. */
+    std::vector<QuadTreeCollider<>> mixedBoxes(int count, std::mt19937* random)
+    {
+        std::uniform_real_distribution<double> position(0.0, WORLD_SIZE);
+        std::uniform_int_distribution<int> smallSize(16, 256), largeSize(WORLD_SIZE / 16, WORLD_SIZE / 4);
+        std::vector<QuadTreeCollider<>> boxes;
+
+        for (int i = 0; i < count; i++)
+        {
+            if (i % 20 == 0)
+                boxes.push_back(makeBox(position(*random), position(*random), largeSize(*random), largeSize(*random)));
+            else
+                boxes.push_back(makeBox(position(*random), position(*random), smallSize(*random), smallSize(*random)));
+        }
+
+        return boxes;
+    }
+
+    QuadTree<> makeTree(const Settings& settings)
+    {
+        QuadTree<> tree(WORLD_SIZE, 0, 0, WORLD_SIZE, settings.maxDivisions, settings.maxEltsPerNode);
+
+        tree.setGridDepth(settings.gridDepth);
+
+        return tree;
+    }
+
+    Result makeResult(const char* name, const char* operation, long long operations, double seconds, const QuadTree<>& tree)
+    {
+        return Result{name, operation, operations, seconds, tree.quadNodes.getNumElements(), tree.quadNodes.getCapacity(),
+            tree.elementNodes.getNumElements(), tree.elementNodes.getCapacity()};
+    }
+
+    /* Inserts every box one at a time. */
+    Result insertWorkload(const char* name, const std::vector<QuadTreeCollider<>>& source, const Settings& settings)
+    {
+        std::vector<QuadTreeCollider<>> boxes = source;
+        QuadTree<> tree = makeTree(settings);
+
+        const double seconds = timeSeconds([&]()
+        {
+            for (QuadTreeCollider<>& box : boxes)
+                tree.insert(&box);
+        });
+
+        return makeResult(name, "insert", (long long)boxes.size(), seconds, tree);
+    }
+
+    /* Moves every box and bulk loads the quadtree from scratch each frame. */
+    Result rebuildWorkload(const Settings& settings, std::mt19937* random)
+    {
+        std::vector<QuadTreeCollider<>> boxes = uniformBoxes(settings.numColliders, random);
+        std::vector<QuadTreeCollider<>*> pointers;
+        std::uniform_int_distribution<int> step(-64, 64);
+        QuadTree<> tree = makeTree(settings);
+
+        for (QuadTreeCollider<>& box : boxes)
+            pointers.push_back(&box);
+
+        double seconds = 0.0;
+
+        for (int frame = 0; frame < settings.numFrames; frame++)
+        {
+            for (QuadTreeCollider<>& box : boxes)
+                box = makeBox((box.left + box.right) / 2 + step(*random), (box.bottom + box.top) / 2 + step(*random),
+                    box.right - box.left, box.top - box.bottom);
+
+            seconds += timeSeconds([&]()
+            {
+                tree.build(pointers.data(), (int)pointers.size(), settings.numThreads);
+            });
+        }
+
+        return makeResult("rebuild", "frame", settings.numFrames, seconds, tree);
+    }
+
+    /* Each frame, removes a tenth of the boxes, reinserts them elsewhere and cleans up the quadtree. */
+    Result churnWorkload(const Settings& settings, std::mt19937* random)
+    {
+        std::vector<QuadTreeCollider<>> boxes = uniformBoxes(settings.numColliders, random);
+        std::vector<int> indices;
+        std::uniform_real_distribution<double> position(0.0, WORLD_SIZE);
+        std::uniform_int_distribution<int> pick(0, settings.numColliders - 1);
+        QuadTree<> tree = makeTree(settings);
+
+        for (QuadTreeCollider<>& box : boxes)
+            indices.push_back(tree.insert(&box));
+
+        const int movesPerFrame = std::max(settings.numColliders / 10, 1);
+        double seconds = 0.0;
+
+        for (int frame = 0; frame < settings.numFrames; frame++)
+        {
+            std::vector<int> moved;
+            std::vector<QuadTreeCollider<>> targets;
+
+            for (int i = 0; i < movesPerFrame; i++)
+            {
+                const int box = pick(*random);
+
+                moved.push_back(box);
+                targets.push_back(makeBox(position(*random), position(*random), boxes[box].right - boxes[box].left,
+                    boxes[box].top - boxes[box].bottom));
+            }
+
+            seconds += timeSeconds([&]()
+            {
+                for (int i = 0; i < movesPerFrame; i++)
+                {
+                    QuadTreeCollider<>& box = boxes[moved[i]];
+
+                    tree.remove(&box, indices[moved[i]]);
+                    box = targets[i];
+                    indices[moved[i]] = tree.insert(&box);
+                }
+
+                tree.cleanup();
+            });
+        }
+
+        return makeResult("churn", "move", (long long)movesPerFrame * settings.numFrames, seconds, tree);
+    }
+
+    /* The churn workload with every frame's moves recorded into command buffers and applied as one batch. */
+    Result batchedWorkload(const Settings& settings, std::mt19937* random)
+    {
+        std::vector<QuadTreeCollider<>> boxes = uniformBoxes(settings.numColliders, random);
+        std::vector<int> indices;
+        std::vector<QuadTreeCommandBuffer<>> buffers(4);
+        std::uniform_real_distribution<double> position(0.0, WORLD_SIZE);
+        std::uniform_int_distribution<int> pick(0, settings.numColliders - 1);
+        QuadTree<> tree = makeTree(settings);
+
+        for (QuadTreeCollider<>& box : boxes)
+            indices.push_back(tree.insert(&box));
+
+        const int movesPerFrame = std::max(settings.numColliders / 10, 1);
+        double seconds = 0.0;
+
+        for (int frame = 0; frame < settings.numFrames; frame++)
+        {
+            std::vector<int> moved;
+            std::vector<QuadTreeCollider<>> targets;
+
+            for (int i = 0; i < movesPerFrame; i++)
+            {
+                const int box = pick(*random);
+
+                moved.push_back(box);
+                targets.push_back(makeBox(position(*random), position(*random), boxes[box].right - boxes[box].left,
+                    boxes[box].top - boxes[box].bottom));
+            }
+
+            seconds += timeSeconds([&]()
+            {
+                for (int i = 0; i < movesPerFrame; i++)
+                {
+                    QuadTreeCollider<>& box = boxes[moved[i]];
+
+                    buffers[i % buffers.size()].update(&box, indices[moved[i]], targets[i]);
+                    box = targets[i];
+                }
+
+                tree.apply(buffers.data(), (int)buffers.size());
+                tree.cleanup();
+
+                for (QuadTreeCommandBuffer<>& buffer : buffers)
+                    buffer.clear();
+            });
+        }
+
+        return makeResult("batched", "move", (long long)movesPerFrame * settings.numFrames, seconds, tree);
+    }
+
+    /* Fills the quadtree with clustered boxes and removes all of them in a random order. */
+    Result despawnWorkload(const Settings& settings, std::mt19937* random)
+    {
+        std::vector<QuadTreeCollider<>> boxes = clusteredBoxes(settings.numColliders, random);
+        std::vector<int> indices, order;
+        QuadTree<> tree = makeTree(settings);
+
+        for (QuadTreeCollider<>& box : boxes)
+        {
+            order.push_back((int)indices.size());
+            indices.push_back(tree.insert(&box));
+        }
+
+        std::shuffle(order.begin(), order.end(), *random);
+
+        const double seconds = timeSeconds([&]()
+        {
+            for (const int box : order)
+                tree.remove(&boxes[box], indices[box]);
+        });
+
+        return makeResult("despawn", "remove", (long long)boxes.size(), seconds, tree);
+    }
+
+    /* Returns whether querying the quadtree with each rectangle finds exactly the live boxes overlapping it. */
+    bool matchesBruteForce(QuadTree<>* tree, const std::vector<QuadTreeCollider<>*>& live,
+        const std::vector<QuadTreeCollider<>>& rects)
+    {
+        FreeList<QuadTreeCollider<>*> output;
+
+        for (const QuadTreeCollider<>& rect : rects)
+        {
+            std::vector<QuadTreeCollider<>*> found, expected;
+
+            output.clear();
+            tree->query(&output, rect.top, rect.bottom, rect.left, rect.right);
+
+            for (int i = 0; i < output.size(); i++)
+                found.push_back(output.at(i));
+            for (QuadTreeCollider<>* box : live)
+                if (overlaps(box->top, box->bottom, box->left, box->right, rect.top, rect.bottom, rect.left, rect.right))
+                    expected.push_back(box);
+
+            std::sort(found.begin(), found.end());
+            std::sort(expected.begin(), expected.end());
+
+            if (found != expected)
+                return false;
+        }
+
+        return true;
+    }
+
+    /* Checks bulk builds and batched commands against brute force, exiting with an error on any difference.
+     * Meant to be run under a sanitizer. */
+    Result verifyWorkload(const Settings& settings, std::mt19937* random)
+    {
+        std::vector<QuadTreeCollider<>> boxes = mixedBoxes(settings.numColliders, random),
+            extras = uniformBoxes(settings.numColliders / 2, random), rects;
+        std::vector<QuadTreeCollider<>*> pointers, live;
+        std::vector<int> indices(boxes.size());
+        std::uniform_real_distribution<double> position(0.0, WORLD_SIZE);
+        std::uniform_int_distribution<int> size(256, 4096);
+        QuadTreeCommandBuffer<> buffers[2];
+        QuadTree<> tree = makeTree(settings);
+
+        for (QuadTreeCollider<>& box : boxes)
+            pointers.push_back(&box);
+        for (int i = 0; i < std::min(settings.numQueries, 200); i++)
+            rects.push_back(makeBox(position(*random), position(*random), size(*random), size(*random)));
+
+        const double seconds = timeSeconds([&]()
+        {
+            /* A single thread and several threads take different build paths. */
+            for (const int numThreads : { 1, 4 })
+            {
+                tree.build(pointers.data(), (int)pointers.size(), numThreads);
+                live = pointers;
+
+                for (int i = 0; i < (int)boxes.size(); i++)
+                    indices[i] = i;
+
+                /* Remove every third box, move every third after it and insert the extra boxes in one batch. */
+                for (int i = 0; i < (int)boxes.size(); i++)
+                {
+                    if (i % 3 == 0)
+                        buffers[i % 2].remove(&boxes[i], indices[i]);
+                    else if (i % 3 == 1)
+                        buffers[i % 2].update(&boxes[i], indices[i], makeBox(position(*random), position(*random),
+                            boxes[i].right - boxes[i].left, boxes[i].top - boxes[i].bottom));
+                }
+
+                for (int i = 0; i < (int)extras.size(); i++)
+                    buffers[i % 2].insert(&extras[i]);
+
+                tree.apply(buffers, 2);
+                live.clear();
+
+                for (const QuadTreeCommandBuffer<>& buffer : buffers)
+                {
+                    for (const QuadTreeCommand<int>& command : buffer.commands)
+                    {
+                        if (command.type == QuadTreeCommand<int>::UPDATE)
+                            *command.collider = command.bounds;
+                        if (command.type != QuadTreeCommand<int>::REMOVE)
+                            live.push_back(command.collider);
+                    }
+                }
+
+                for (int i = 0; i < (int)boxes.size(); i++)
+                    if (i % 3 == 2)
+                        live.push_back(&boxes[i]);
+
+                for (QuadTreeCommandBuffer<>& buffer : buffers)
+                    buffer.clear();
+
+                if (!matchesBruteForce(&tree, live, rects))
+                {
+                    std::fprintf(stderr, "verify: query results differ from brute force after a batch\n");
+                    std::exit(1);
+                }
+
+                /* Remove half of the untouched boxes one at a time, then clean up and compare again. */
+                for (int i = 2; i < (int)boxes.size(); i += 6)
+                    tree.remove(&boxes[i], indices[i]);
+
+                live.erase(std::remove_if(live.begin(), live.end(), [&](const QuadTreeCollider<>* box)
+                {
+                    return box >= boxes.data() && box < boxes.data() + boxes.size() && (box - boxes.data()) % 6 == 2;
+                }), live.end());
+
+                tree.cleanup();
+
+                if (!matchesBruteForce(&tree, live, rects))
+                {
+                    std::fprintf(stderr, "verify: query results differ from brute force after removals\n");
+                    std::exit(1);
+                }
+
+                /* Refill the boxes in place, as the quadtree holds pointers to them. */
+                const std::vector<QuadTreeCollider<>> nextBoxes = mixedBoxes(settings.numColliders, random),
+                    nextExtras = uniformBoxes(settings.numColliders / 2, random);
+
+                std::copy(nextBoxes.begin(), nextBoxes.end(), boxes.begin());
+                std::copy(nextExtras.begin(), nextExtras.end(), extras.begin());
+            }
+        });
+
+        return makeResult("verify", "check", 2, seconds, tree);
+    }
+
+    /* Runs many small rectangle queries against a static quadtree. */
+    Result queryWorkload(const Settings& settings, std::mt19937* random)
+    {
+        std::vector<QuadTreeCollider<>> boxes = uniformBoxes(settings.numColliders, random);
+        std::vector<QuadTreeCollider<>> rects;
+        std::uniform_real_distribution<double> position(0.0, WORLD_SIZE);
+        std::uniform_int_distribution<int> size(256, 2048);
+        FreeList<QuadTreeCollider<>*> output;
+        QuadTree<> tree = makeTree(settings);
+
+        for (QuadTreeCollider<>& box : boxes)
+            tree.insert(&box);
+        for (int i = 0; i < settings.numQueries; i++)
+            rects.push_back(makeBox(position(*random), position(*random), size(*random), size(*random)));
+
+        long long found = 0;
+
+        const double seconds = timeSeconds([&]()
+        {
+            for (const QuadTreeCollider<>& rect : rects)
+            {
+                output.clear();
+                tree.query(&output, rect.top, rect.bottom, rect.left, rect.right);
+                found += output.size();
+            }
+        });
+
+        /* Keep the results observable so the queries cannot be optimised away. */
+        if (found < 0)
+            std::printf("\n");
+
+        return makeResult("query", "query", settings.numQueries, seconds, tree);
+    }
+
+    /* Points spread evenly across the world, and circles of varied radius to search them with. */
+    void pointsAndCircles(const Settings& settings, std::mt19937* random, std::vector<QuadTreePoint<>>* points,
+        std::vector<std::pair<QuadTreePoint<>, int>>* circles)
+    {
+        std::uniform_int_distribution<int> position(0, WORLD_SIZE - 1), radius(128, 1024);
+
+        for (int i = 0; i < settings.numColliders; i++)
+            points->push_back(QuadTreePoint<>(position(*random), position(*random)));
+        for (int i = 0; i < settings.numQueries; i++)
+            circles->push_back(std::make_pair(QuadTreePoint<>(position(*random), position(*random)), radius(*random)));
+    }
+
+    /* Runs radius queries against points stored as boxes of zero size, filtering a query of each circle's
+     * bounding box by distance. */
+    Result pointBoxesWorkload(const Settings& settings, std::mt19937* random)
+    {
+        std::vector<QuadTreePoint<>> points;
+        std::vector<std::pair<QuadTreePoint<>, int>> circles;
+        std::vector<QuadTreeCollider<>> boxes;
+        QuadTree<> tree = makeTree(settings);
+
+        pointsAndCircles(settings, random, &points, &circles);
+
+        for (const QuadTreePoint<>& point : points)
+            boxes.push_back(QuadTreeCollider<>(point.y, point.y, point.x, point.x));
+        for (QuadTreeCollider<>& box : boxes)
+            tree.insert(&box);
+
+        long long found = 0;
+
+        const double seconds = timeSeconds([&]()
+        {
+            for (const std::pair<QuadTreePoint<>, int>& circle : circles)
+            {
+                const QuadTreePoint<>& centre = circle.first;
+                const double cutoff = (double)circle.second * circle.second;
+
+                tree.queryVisit(centre.y + circle.second, centre.y - circle.second, centre.x - circle.second,
+                    centre.x + circle.second, [&](QuadTreeCollider<>* box)
+                {
+                    const double dx = (double)box->left - centre.x, dy = (double)box->top - centre.y;
+
+                    found += dx * dx + dy * dy <= cutoff;
+                    return true;
+                });
+            }
+        });
+
+        /* Keep the results observable so the queries cannot be optimised away. */
+        if (found < 0)
+            std::printf("\n");
+
+        return makeResult("point-boxes", "query", settings.numQueries, seconds, tree);
+    }
+
+    /* Runs the radius queries of the point-boxes workload against a point quadtree. */
+    Result pointsWorkload(const Settings& settings, std::mt19937* random)
+    {
+        std::vector<QuadTreePoint<>> points;
+        std::vector<std::pair<QuadTreePoint<>, int>> circles;
+        PointQuadTree<> tree(WORLD_SIZE, 0, 0, WORLD_SIZE, settings.maxDivisions, settings.maxEltsPerNode);
+
+        pointsAndCircles(settings, random, &points, &circles);
+
+        for (QuadTreePoint<>& point : points)
+            tree.insert(&point);
+
+        long long found = 0;
+
+        const double seconds = timeSeconds([&]()
+        {
+            for (const std::pair<QuadTreePoint<>, int>& circle : circles)
+            {
+                tree.queryRadiusVisit(circle.first.x, circle.first.y, circle.second, [&](QuadTreePoint<>*)
+                {
+                    found++;
+                    return true;
+                });
+            }
+        });
+
+        if (found < 0)
+            std::printf("\n");
+
+        /* Points are linked into their leaves directly, so they stand in for the element nodes. */
+        return Result{"points", "query", settings.numQueries, seconds, tree.quadNodes.getNumElements(),
+            tree.quadNodes.getCapacity(), tree.points.getNumElements(), tree.points.getCapacity()};
+    }
+
+    /* Runs rectangle queries for one category against clustered boxes, each cluster holding its own category. */
+    Result filteredQueryWorkload(const Settings& settings, std::mt19937* random)
+    {
+        std::vector<QuadTreeCollider<>> boxes = clusteredBoxes(settings.numColliders, random);
+        std::vector<QuadTreeCollider<>> rects;
+        std::uniform_real_distribution<double> position(0.0, WORLD_SIZE);
+        std::uniform_int_distribution<int> size(256, 2048);
+        FreeList<QuadTreeCollider<>*> output;
+        QuadTree<> tree = makeTree(settings);
+
+        for (int i = 0; i < (int)boxes.size(); i++)
+            tree.insert(&boxes[i], 1u << (i % 8));
+        for (int i = 0; i < settings.numQueries; i++)
+            rects.push_back(makeBox(position(*random), position(*random), size(*random), size(*random)));
+
+        long long found = 0;
+
+        const double seconds = timeSeconds([&]()
+        {
+            for (const QuadTreeCollider<>& rect : rects)
+            {
+                output.clear();
+                tree.query(&output, rect.top, rect.bottom, rect.left, rect.right, 1u);
+                found += output.size();
+            }
+        });
+
+        if (found < 0)
+            std::printf("\n");
+
+        return makeResult("filtered", "query", settings.numQueries, seconds, tree);
+    }
+
+    /* Finds every overlap between two quadtrees of boxes covering the same world. */
+    Result joinWorkload(const Settings& settings, std::mt19937* random)
+    {
+        std::vector<QuadTreeCollider<>> first = uniformBoxes(settings.numColliders, random),
+            second = uniformBoxes(settings.numColliders, random);
+        FreeList<ColliderPair<int>> output;
+        QuadTree<> firstTree = makeTree(settings), secondTree = makeTree(settings);
+
+        for (QuadTreeCollider<>& box : first)
+            firstTree.insert(&box);
+        for (QuadTreeCollider<>& box : second)
+            secondTree.insert(&box);
+
+        double seconds = 0.0;
+
+        for (int frame = 0; frame < settings.numFrames; frame++)
+        {
+            output.clear();
+            seconds += timeSeconds([&]()
+            {
+                firstTree.findAllPairs(secondTree, &output);
+            });
+        }
+
+        return makeResult("join", "frame", settings.numFrames, seconds, firstTree);
+    }
+
+    void printResult(const Result& result)
+    {
+        const double nsPerOp = result.operations ? result.seconds * 1e9 / result.operations : 0.0,
+            opsPerSecond = result.seconds > 0.0 ? result.operations / result.seconds : 0.0;
+
+        std::printf("{\"workload\": \"%s\", \"operation\": \"%s\", \"operations\": %lld, \"seconds\": %.6f, "
+            "\"ns_per_op\": %.1f, \"ops_per_second\": %.1f, \"peak_memory_kb\": %lld, \"quad_nodes\": %d, "
+            "\"quad_node_capacity\": %d, \"element_nodes\": %d, \"element_node_capacity\": %d}\n",
+            result.name, result.operation, result.operations, result.seconds, nsPerOp, opsPerSecond,
+            peakMemoryKilobytes(), result.quadNodes, result.quadNodeCapacity, result.elementNodes,
+            result.elementNodeCapacity);
+        std::fflush(stdout);
+    }
+
+    bool parseArguments(int argc, char** argv, Settings* settings)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const char* argument = argv[i];
+
+            if (i + 1 >= argc)
+                return false;
+
+            const char* value = argv[++i];
+
+            if (!std::strcmp(argument, "--colliders"))
+                settings->numColliders = std::atoi(value);
+            else if (!std::strcmp(argument, "--frames"))
+                settings->numFrames = std::atoi(value);
+            else if (!std::strcmp(argument, "--queries"))
+                settings->numQueries = std::atoi(value);
+            else if (!std::strcmp(argument, "--max-divisions"))
+                settings->maxDivisions = std::atoi(value);
+            else if (!std::strcmp(argument, "--max-elements"))
+                settings->maxEltsPerNode = std::atoi(value);
+            else if (!std::strcmp(argument, "--threads"))
+                settings->numThreads = std::atoi(value);
+            else if (!std::strcmp(argument, "--grid-depth"))
+                settings->gridDepth = std::atoi(value);
+            else if (!std::strcmp(argument, "--seed"))
+                settings->seed = (unsigned int)std::strtoul(value, nullptr, 10);
+            else if (!std::strcmp(argument, "--workload"))
+                settings->workload = value;
+            else
+                return false;
+        }
+
+        return settings->numColliders > 0 && settings->numFrames > 0 && settings->numQueries > 0 &&
+            settings->maxDivisions >= 0 && settings->maxEltsPerNode > 0 && settings->gridDepth >= 0 &&
+            settings->gridDepth <= std::min(settings->maxDivisions, 15);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Settings settings;
+
+    if (!parseArguments(argc, argv, &settings))
+    {
+        std::fprintf(stderr, "usage: %s [--colliders N] [--frames N] [--queries N] [--max-divisions N] "
+            "[--max-elements N] [--threads N] [--grid-depth N] [--seed N] [--workload NAME]\n", argv[0]);
+        return 1;
+    }
+
+    std::mt19937 random(settings.seed);
+
+    const std::pair<const char*, std::function<Result()>> workloads[] =
+    {
+        {"uniform", [&]() { return insertWorkload("uniform", uniformBoxes(settings.numColliders, &random), settings); }},
+        {"clustered", [&]() { return insertWorkload("clustered", clusteredBoxes(settings.numColliders, &random), settings); }},
+        {"mixed", [&]() { return insertWorkload("mixed", mixedBoxes(settings.numColliders, &random), settings); }},
+        {"rebuild", [&]() { return rebuildWorkload(settings, &random); }},
+        {"churn", [&]() { return churnWorkload(settings, &random); }},
+        {"batched", [&]() { return batchedWorkload(settings, &random); }},
+        {"despawn", [&]() { return despawnWorkload(settings, &random); }},
+        {"query", [&]() { return queryWorkload(settings, &random); }},
+        {"filtered", [&]() { return filteredQueryWorkload(settings, &random); }},
+        {"join", [&]() { return joinWorkload(settings, &random); }},
+        {"verify", [&]() { return verifyWorkload(settings, &random); }},
+        {"point-boxes", [&]() { return pointBoxesWorkload(settings, &random); }},
+        {"points", [&]() { return pointsWorkload(settings, &random); }},
+    };
+
+    bool found = settings.workload.empty();
+
+    for (const auto& workload : workloads)
+    {
+        if (!settings.workload.empty() && settings.workload != workload.first)
+            continue;
+
+        found = true;
+        printResult(workload.second());
+    }
+
+    if (!found)
+    {
+        std::fprintf(stderr, "unknown workload: %s\n", settings.workload.c_str());
+        return 1;
+    }
+
+    return 0;
+}
@@ -25,17 +25,26 @@ FreeList<TypeName, FixedSize>::FreeList(const FreeList& other)
 template<typename TypeName, const int FixedSize>
 void FreeList<TypeName, FixedSize>::operator=(const FreeList& other)
 {
+    if (this == &other)
+        return;
+
+    /* A buffer of the same capacity is reused, so repeatedly copying lists of a steady size does not allocate.
+     * Otherwise the capacity is matched exactly, which lets a copy release unused storage. */
+    if (this->capacity != other.capacity)
+    {
+        if (this->data != this->fixed) delete[] this->data;
+
+        if (other.data == other.fixed)
+            this->data = this->fixed;
+        else
+            this->data = new TypeName[other.capacity];
+    }
+
     this->capacity = other.capacity;
     this->listSize = other.listSize;
     this->numElements = other.numElements;
     this->freeElement = other.freeElement;
 
-    if (this->data != this->fixed) delete[] this->data;
-
-    if (other.data == other.fixed)
-        this->data = this->fixed;
-    else
-        this->data = new TypeName[this->capacity];
     std::copy(other.data, other.data + other.capacity, this->data);
 }
 
@@ -0,0 +1,93 @@
+#ifndef LINEAR_QUADTREE_HPP_INCLUDED
+#define LINEAR_QUADTREE_HPP_INCLUDED
+
+#include <cstdint>
+#include <vector>
+
+#include "quadtree.hpp"
+
+/* A quadtree without nodes, for static or rebuilt-every-frame data. Each collider is assigned to the smallest
+ * cell, at most maxDivisions levels deep, that contains it. The colliders are kept sorted by a key made of
+ * the Z-order code of their cell followed by its depth, so every subtree is a contiguous run of the sorted
+ * arrays. Queries descend by binary searching the compact array of occupied cells and scan the boundaries of
+ * each run several boxes at a time. No collider is stored twice.
+ *
+ * Changes are sorted into the arrays lazily, by commit or by the next non-const query. */
+template<typename CoordType = int>
+class LinearQuadTree
+{
+public:
+    /* maxDivisions may not exceed MAX_DIVISIONS. */
+    LinearQuadTree(CoordType top, CoordType bottom, CoordType left, CoordType right, int maxDivisions);
+
+    const static int MAX_DIVISIONS = 29;
+
+    /* Inserts the collider into the quadtree. */
+    int insert(QuadTreeCollider<CoordType>* collider);
+
+    /* Removes the collider from the quadtree. The boundaries it was inserted with are used. */
+    void remove(const QuadTreeCollider<CoordType>* collider, int colliderIndex);
+
+    /* Clears the quadtree and loads the given colliders with a single sort. The collider at position i of the
+     * array is given the collider index i. */
+    void build(QuadTreeCollider<CoordType>* const* colliderArray, int numColliders);
+
+    /* Clears the quadtree of all inserted elements. */
+    void clearElements();
+
+    /* Sorts the changes made since the last commit into the cell arrays. */
+    void commit();
+
+    /* Populates the freelist with the pointers to the colliders inside the boundaries, committing any changes
+     * first. */
+    void query(FreeList<QuadTreeCollider<CoordType>*>* output, CoordType top, CoordType bottom, CoordType left,
+        CoordType right);
+
+    /* Calls the visitor with the pointer to every collider inside the boundaries. The visitor returns false to
+     * stop the query early, in which case false is returned. Every change must have been committed. Safe to call
+     * from several threads while the quadtree is not modified. */
+    template<typename Visitor>
+    bool queryVisit(CoordType top, CoordType bottom, CoordType left, CoordType right, Visitor visitor) const;
+
+    FreeList<QuadTreeCollider<CoordType>*> colliders;
+
+#ifndef NO_PRIVATE
+    private:
+#endif
+    /* The key of collider indices that are removed or lie outside the quadtree. */
+    constexpr static std::uint64_t NO_CELL = ~(std::uint64_t)0;
+
+    CoordType topBound, bottomBound, leftBound, rightBound;
+
+    int maxDivisions;
+
+    /* Copies of the collider boundaries and cell keys, indexed by collider index. */
+    std::vector<CoordType> colliderTops, colliderBottoms, colliderLefts, colliderRights;
+    std::vector<std::uint64_t> colliderKeys;
+
+    /* Whether the arrays below reflect every change. */
+    bool committed;
+
+    /* The keys of the occupied cells in ascending order. Cell i holds the sorted entries from cellStarts[i]
+     * up to cellStarts[i + 1]. */
+    std::vector<std::uint64_t> cellKeys;
+    std::vector<int> cellStarts;
+
+    /* The collider indices and boundaries of every stored collider, sorted by cell key. */
+    std::vector<int> entryColliders;
+    std::vector<CoordType> entryTops, entryBottoms, entryLefts, entryRights;
+
+    /* Returns the key of the cell at the given depth whose Z-order code is the given prefix. */
+    std::uint64_t cellKey(std::uint64_t prefix, int depth) const;
+
+    /* Returns the key of the smallest cell containing the given boundaries, or NO_CELL if they lie outside the
+     * quadtree. */
+    std::uint64_t findCell(const QuadTreeCollider<CoordType>& bounds) const;
+
+    /* Stores the boundaries and cell key of the given collider index. */
+    void setBounds(int colliderIndex, const QuadTreeCollider<CoordType>& bounds);
+};
+
+#include "linearquadtree.inl"
+
+#endif
@@ -0,0 +1,296 @@
+#ifndef LINEAR_QUADTREE_INL_INCLUDED
+#define LINEAR_QUADTREE_INL_INCLUDED
+
+#include <algorithm>
+#include <utility>
+
+template<typename CoordType>
+LinearQuadTree<CoordType>::LinearQuadTree(CoordType top, CoordType bottom, CoordType left, CoordType right,
+    int maxDivisions)
+    : topBound(top), bottomBound(bottom), leftBound(left), rightBound(right), maxDivisions(maxDivisions),
+      committed(true)
+{
+    assert(maxDivisions >= 0 && maxDivisions <= MAX_DIVISIONS);
+
+    this->cellStarts.push_back(0);
+}
+
+template<typename CoordType>
+int LinearQuadTree<CoordType>::insert(QuadTreeCollider<CoordType>* collider)
+{
+    const int colliderIndex = this->colliders.insert();
+
+    this->colliders.at(colliderIndex) = collider;
+    this->setBounds(colliderIndex, *collider);
+    this->committed = false;
+
+    return colliderIndex;
+}
+
+template<typename CoordType>
+void LinearQuadTree<CoordType>::remove(const QuadTreeCollider<CoordType>* collider, int colliderIndex)
+{
+    assert(this->colliders.at(colliderIndex) == collider);
+    (void)collider;
+
+    this->colliders.erase(colliderIndex);
+    this->colliderKeys[colliderIndex] = NO_CELL;
+    this->committed = false;
+}
+
+template<typename CoordType>
+void LinearQuadTree<CoordType>::build(QuadTreeCollider<CoordType>* const* colliderArray, int numColliders)
+{
+    this->clearElements();
+
+    for (int i = 0; i < numColliders; i++)
+    {
+        const int colliderIndex = this->colliders.insert();
+
+        this->colliders.at(colliderIndex) = colliderArray[i];
+        this->setBounds(colliderIndex, *colliderArray[i]);
+    }
+
+    this->committed = false;
+    this->commit();
+}
+
+template<typename CoordType>
+void LinearQuadTree<CoordType>::clearElements()
+{
+    this->colliders.clear();
+    this->colliderKeys.clear();
+
+    this->cellKeys.clear();
+    this->cellStarts.assign(1, 0);
+
+    this->entryColliders.clear();
+    this->entryTops.clear();
+    this->entryBottoms.clear();
+    this->entryLefts.clear();
+    this->entryRights.clear();
+
+    this->committed = true;
+}
+
+template<typename CoordType>
+void LinearQuadTree<CoordType>::commit()
+{
+    if (this->committed)
+        return;
+
+    std::vector<std::pair<std::uint64_t, int>> sortedKeys;
+
+    for (int colliderIndex = 0; colliderIndex < (int)this->colliderKeys.size(); colliderIndex++)
+        if (this->colliderKeys[colliderIndex] != NO_CELL)
+            sortedKeys.emplace_back(this->colliderKeys[colliderIndex], colliderIndex);
+
+    std::sort(sortedKeys.begin(), sortedKeys.end());
+
+    const int numEntries = (int)sortedKeys.size();
+
+    this->cellKeys.clear();
+    this->cellStarts.clear();
+    this->entryColliders.resize(numEntries);
+    this->entryTops.resize(numEntries);
+    this->entryBottoms.resize(numEntries);
+    this->entryLefts.resize(numEntries);
+    this->entryRights.resize(numEntries);
+
+    for (int i = 0; i < numEntries; i++)
+    {
+        const int colliderIndex = sortedKeys[i].second;
+
+        if (i == 0 || sortedKeys[i].first != sortedKeys[i - 1].first)
+        {
+            this->cellKeys.push_back(sortedKeys[i].first);
+            this->cellStarts.push_back(i);
+        }
+
+        this->entryColliders[i] = colliderIndex;
+        this->entryTops[i] = this->colliderTops[colliderIndex];
+        this->entryBottoms[i] = this->colliderBottoms[colliderIndex];
+        this->entryLefts[i] = this->colliderLefts[colliderIndex];
+        this->entryRights[i] = this->colliderRights[colliderIndex];
+    }
+
+    this->cellStarts.push_back(numEntries);
+    this->committed = true;
+}
+
+template<typename CoordType>
+void LinearQuadTree<CoordType>::query(FreeList<QuadTreeCollider<CoordType>*>* output, CoordType top, CoordType bottom,
+    CoordType left, CoordType right)
+{
+    this->commit();
+
+    this->queryVisit(top, bottom, left, right, [output](QuadTreeCollider<CoordType>* collider)
+    {
+        output->at(output->pushBack()) = collider;
+        return true;
+    });
+}
+
+template<typename CoordType>
+template<typename Visitor>
+bool LinearQuadTree<CoordType>::queryVisit(CoordType top, CoordType bottom, CoordType left, CoordType right,
+    Visitor visitor) const
+{
+    assert(this->committed);
+
+    /* Each entry refers to a cell and the range of occupied cells within its subtree. */
+    struct QueryEntry
+    {
+        QuadNodeData<CoordType> data;
+        std::uint64_t prefix;
+        int firstCell, lastCell;
+    };
+
+    if (this->cellKeys.empty() ||
+        this->topBound <= bottom || this->bottomBound > top || this->rightBound <= left || this->leftBound > right)
+        return true;
+
+    const auto visitEntries = [&](int firstEntry, int lastEntry, bool test)
+    {
+        if (!test)
+        {
+            for (int i = firstEntry; i < lastEntry; i++)
+                if (!visitor(this->colliders.at(this->entryColliders[i])))
+                    return false;
+
+            return true;
+        }
+
+        return forEachOverlap(this->entryTops.data(), this->entryBottoms.data(), this->entryLefts.data(),
+            this->entryRights.data(), firstEntry, lastEntry, top, bottom, left, right, [&](int entry)
+        {
+            return (bool)visitor(this->colliders.at(this->entryColliders[entry]));
+        });
+    };
+
+    FreeList<QueryEntry> toProcess;
+
+    QueryEntry& root = toProcess.at(toProcess.pushBack());
+
+    root.data = QuadNodeData<CoordType>(0, 0, this->topBound, this->bottomBound, this->leftBound, this->rightBound);
+    root.prefix = 0;
+    root.firstCell = 0;
+    root.lastCell = (int)this->cellKeys.size();
+
+    while (toProcess.size())
+    {
+        QueryEntry entry = toProcess.at(toProcess.size() - 1);
+        const QuadNodeData<CoordType>& data = entry.data;
+
+        toProcess.popBack();
+
+        /* Every collider of a cell inside the boundaries overlaps them, so whole subtrees are visited untested. */
+        if (left <= data.left && right >= data.right && bottom <= data.bottom && top >= data.top)
+        {
+            if (!visitEntries(this->cellStarts[entry.firstCell], this->cellStarts[entry.lastCell], false))
+                return false;
+
+            continue;
+        }
+
+        /* A cell's own colliders sort before those of its descendants. */
+        if (this->cellKeys[entry.firstCell] == this->cellKey(entry.prefix, data.depth))
+        {
+            if (!visitEntries(this->cellStarts[entry.firstCell], this->cellStarts[entry.firstCell + 1], true))
+                return false;
+
+            entry.firstCell++;
+        }
+
+        if (entry.firstCell == entry.lastCell || data.depth >= this->maxDivisions)
+            continue;
+
+        /* Split the remaining cells between the children, whose subtrees follow each other in key order. */
+        const CoordType halfX = quadMidpoint(data.left, data.right), halfY = quadMidpoint(data.bottom, data.top);
+        int childFirst = entry.firstCell;
+
+        for (int child = 0; child < 4; child++)
+        {
+            const std::uint64_t childPrefix = entry.prefix * 4 + child;
+            const int childLast = child == 3 ? entry.lastCell : (int)(std::lower_bound(this->cellKeys.begin() + childFirst,
+                this->cellKeys.begin() + entry.lastCell, this->cellKey(childPrefix + 1, data.depth + 1)) - this->cellKeys.begin());
+
+            if (childFirst < childLast &&
+                (child & 1 ? right >= halfX : left < halfX) && (child & 2 ? bottom < halfY : top >= halfY))
+            {
+                QueryEntry& childEntry = toProcess.at(toProcess.pushBack());
+
+                childEntry.data = childNodeData(data, 0, child);
+                childEntry.prefix = childPrefix;
+                childEntry.firstCell = childFirst;
+                childEntry.lastCell = childLast;
+            }
+
+            childFirst = childLast;
+        }
+    }
+
+    return true;
+}
+
+template<typename CoordType>
+std::uint64_t LinearQuadTree<CoordType>::cellKey(std::uint64_t prefix, int depth) const
+{
+    /* The Z-order code is extended to the deepest level, so that a cell and its descendants share its high
+     * bits, and the depth breaks the tie between cells starting at the same corner. */
+    return (prefix << (2 * (this->maxDivisions - depth)) << 5) | (std::uint64_t)depth;
+}
+
+template<typename CoordType>
+std::uint64_t LinearQuadTree<CoordType>::findCell(const QuadTreeCollider<CoordType>& bounds) const
+{
+    if (bounds.bottom >= this->topBound || bounds.top < this->bottomBound || bounds.left >= this->rightBound ||
+        bounds.right < this->leftBound)
+        return NO_CELL;
+
+    QuadNodeData<CoordType> data(0, 0, this->topBound, this->bottomBound, this->leftBound, this->rightBound);
+    std::uint64_t prefix = 0;
+
+    /* Descend into the child containing the boundaries for as long as there is one. */
+    while (data.depth < this->maxDivisions)
+    {
+        const CoordType halfX = quadMidpoint(data.left, data.right), halfY = quadMidpoint(data.bottom, data.top);
+
+        /* Stop at the first cell whose midlines the boundaries straddle. */
+        if ((bounds.left < halfX && bounds.right >= halfX) || (bounds.bottom < halfY && bounds.top >= halfY))
+            break;
+
+        const int child = (bounds.left >= halfX ? 1 : 0) + (bounds.top < halfY ? 2 : 0);
+
+        prefix = prefix * 4 + child;
+        data = childNodeData(data, 0, child);
+    }
+
+    return this->cellKey(prefix, data.depth);
+}
+
+template<typename CoordType>
+void LinearQuadTree<CoordType>::setBounds(int colliderIndex, const QuadTreeCollider<CoordType>& bounds)
+{
+    /* The collider freelist only grows one index at a time, so growing the arrays to its size suffices. */
+    if ((int)this->colliderTops.size() <= colliderIndex)
+    {
+        const int newSize = this->colliders.size();
+
+        this->colliderTops.resize(newSize);
+        this->colliderBottoms.resize(newSize);
+        this->colliderLefts.resize(newSize);
+        this->colliderRights.resize(newSize);
+    }
+
+    if ((int)this->colliderKeys.size() <= colliderIndex)
+        this->colliderKeys.resize(this->colliders.size(), NO_CELL);
+
+    this->colliderTops[colliderIndex] = bounds.top;
+    this->colliderBottoms[colliderIndex] = bounds.bottom;
+    this->colliderLefts[colliderIndex] = bounds.left;
+    this->colliderRights[colliderIndex] = bounds.right;
+    this->colliderKeys[colliderIndex] = this->findCell(bounds);
+}
+
+#endif
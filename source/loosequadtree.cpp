@@ -0,0 +1,6 @@
+#include "loosequadtree.hpp"
+
+LooseQuadNode::LooseQuadNode(int firstChild, int firstElement, int numElements)
+    : firstChild(firstChild), firstElement(firstElement), numElements(numElements)
+{
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#ifndef LOOSE_QUADTREE_HPP_INCLUDED
+#define LOOSE_QUADTREE_HPP_INCLUDED
+
+#include <vector>
+
+#include "quadtree.hpp"
+
+/* Stores data about a single node in a loose quadtree. Unlike a QuadNode, a node may hold elements and
+ * children at the same time. */
+struct LooseQuadNode
+{
+    const static int NO_CHILDREN = -1;
+
+    LooseQuadNode(int firstChild = NO_CHILDREN, int firstElement = ElementNode::NONE, int numElements = 0);
+
+    int firstChild, firstElement, numElements;
+};
+
+/* A quadtree whose node boundaries are expanded by a looseness factor, so that every collider is stored in
+ * exactly one node, chosen from its centre and size. Colliders are never duplicated, queries need no
+ * deduplication and insert, remove and update only descend once. */
+template<typename CoordType = int>
+class LooseQuadTree
+{
+public:
+    /* A looseness of 2 doubles the width and height of every node. It must be greater than 1. */
+    LooseQuadTree(CoordType top, CoordType bottom, CoordType left, CoordType right, int maxDivisions, int maxEltsPerNode,
+        double looseness = 2.0);
+
+    /* Inserts the collider into the quadtree. */
+    int insert(QuadTreeCollider<CoordType>* collider);
+
+    /* Removes the collider from the quadtree. */
+    void remove(const QuadTreeCollider<CoordType>* collider, int colliderIndex);
+
+    /* Moves an inserted collider to its new boundaries. Returns immediately if it stays in the same node. */
+    void update(int colliderIndex, const QuadTreeCollider<CoordType>& newBounds);
+
+    /* Clears the quadtree of all inserted elements. */
+    void clearElements();
+
+    /* Removes every group of four childless, empty children. */
+    void cleanup();
+
+    /* Populates the freelist with the pointers to the colliders inside the boundaries. Safe to call from
+     * several threads while the quadtree is not modified. */
+    void query(FreeList<QuadTreeCollider<CoordType>*>* output, CoordType top, CoordType bottom, CoordType left,
+        CoordType right) const;
+
+    FreeList<QuadTreeCollider<CoordType>*> colliders;
+    FreeList<LooseQuadNode> quadNodes;
+    FreeList<ElementNode> elementNodes;
+
+#ifndef NO_PRIVATE
+    private:
+#endif
+    CoordType topBound, bottomBound, leftBound, rightBound;
+
+    int maxDivisions, maxEltsPerNode;
+
+    double looseness;
+
+    int rootNodeIndex;
+
+    /* Copies of the collider boundaries, and the node and element node holding each collider, indexed by
+     * collider index. */
+    std::vector<CoordType> colliderTops, colliderBottoms, colliderLefts, colliderRights;
+    std::vector<int> colliderNodes, colliderElements;
+
+    /* The previous element node in the same node's list, indexed by element node, so that a collider is unlinked
+     * without walking the list. Branches near the root may hold any number of large colliders. */
+    std::vector<int> elementPrevious;
+
+    /* Returns how far a node spanning [low, high) is expanded on each side. */
+    CoordType looseMargin(CoordType low, CoordType high) const;
+
+    /* Returns the data of the deepest existing node that the given collider index fits in. */
+    QuadNodeData<CoordType> findNode(int colliderIndex) const;
+
+    /* Stores the boundaries of the given collider index. */
+    void setBounds(int colliderIndex, const QuadTreeCollider<CoordType>& bounds);
+
+    /* Links the given collider index into the given node, subdividing it if needed and allowed. */
+    void nodeInsert(int colliderIndex, const QuadNodeData<CoordType>& data);
+
+    /* Links the given element node at the front of the given node's list. */
+    void linkElement(int elementIndex, int quadNodeIndex);
+
+    /* Unlinks the given collider index from the node holding it. */
+    void nodeRemove(int colliderIndex);
+
+    /* Creates the children of the given node and moves down the elements that fit in them. */
+    void subdivideNode(const QuadNodeData<CoordType>& data);
+};
+
+#include "loosequadtree.inl"
+
+#endif
\ No newline at end of file
@@ -0,0 +1,324 @@
+#ifndef LOOSE_QUADTREE_INL_INCLUDED
+#define LOOSE_QUADTREE_INL_INCLUDED
+
+template<typename CoordType>
+LooseQuadTree<CoordType>::LooseQuadTree(CoordType top, CoordType bottom, CoordType left, CoordType right,
+    int maxDivisions, int maxEltsPerNode, double looseness)
+    : topBound(top), bottomBound(bottom), leftBound(left), rightBound(right),
+      maxDivisions(maxDivisions), maxEltsPerNode(maxEltsPerNode), looseness(looseness)
+{
+    assert(looseness > 1.0);
+
+    this->rootNodeIndex = this->quadNodes.insert();
+    this->quadNodes.at(this->rootNodeIndex) = LooseQuadNode();
+}
+
+template<typename CoordType>
+int LooseQuadTree<CoordType>::insert(QuadTreeCollider<CoordType>* collider)
+{
+    const int colliderIndex = this->colliders.insert();
+
+    this->colliders.at(colliderIndex) = collider;
+    this->setBounds(colliderIndex, *collider);
+    this->nodeInsert(colliderIndex, this->findNode(colliderIndex));
+
+    return colliderIndex;
+}
+
+template<typename CoordType>
+void LooseQuadTree<CoordType>::remove(const QuadTreeCollider<CoordType>* collider, int colliderIndex)
+{
+    assert(this->colliders.at(colliderIndex) == collider);
+    (void)collider;
+
+    this->nodeRemove(colliderIndex);
+    this->colliders.erase(colliderIndex);
+}
+
+template<typename CoordType>
+void LooseQuadTree<CoordType>::update(int colliderIndex, const QuadTreeCollider<CoordType>& newBounds)
+{
+    this->setBounds(colliderIndex, newBounds);
+
+    const QuadNodeData<CoordType> target = this->findNode(colliderIndex);
+
+    if (target.quadNodeIndex == this->colliderNodes[colliderIndex])
+        return;
+
+    this->nodeRemove(colliderIndex);
+    this->nodeInsert(colliderIndex, target);
+}
+
+template<typename CoordType>
+void LooseQuadTree<CoordType>::clearElements()
+{
+    this->elementNodes.clear();
+    this->colliders.clear();
+
+    FreeList<int> toProcess;
+
+    toProcess.at(toProcess.pushBack()) = this->rootNodeIndex;
+
+    /* The nodes are kept, because they will most likely be needed again soon. */
+    while (toProcess.size())
+    {
+        LooseQuadNode& node = this->quadNodes.at(toProcess.at(toProcess.size() - 1));
+
+        toProcess.popBack();
+
+        node.firstElement = ElementNode::NONE;
+        node.numElements = 0;
+
+        if (node.firstChild != LooseQuadNode::NO_CHILDREN)
+            for (int i = 0; i < 4; i++)
+                toProcess.at(toProcess.pushBack()) = node.firstChild + i;
+    }
+}
+
+template<typename CoordType>
+void LooseQuadTree<CoordType>::cleanup()
+{
+    FreeList<int> toProcess, branches;
+
+    toProcess.at(toProcess.pushBack()) = this->rootNodeIndex;
+
+    /* Collect the branches in pre-order, so that walking the list backwards visits children first. */
+    while (toProcess.size())
+    {
+        const int nodeIndex = toProcess.at(toProcess.size() - 1),
+            firstChild = this->quadNodes.at(nodeIndex).firstChild;
+
+        toProcess.popBack();
+
+        if (firstChild == LooseQuadNode::NO_CHILDREN)
+            continue;
+
+        branches.at(branches.pushBack()) = nodeIndex;
+
+        for (int i = 0; i < 4; i++)
+            toProcess.at(toProcess.pushBack()) = firstChild + i;
+    }
+
+    for (int i = branches.size() - 1; i >= 0; i--)
+    {
+        const int nodeIndex = branches.at(i), firstChild = this->quadNodes.at(nodeIndex).firstChild;
+        bool removable = true;
+
+        for (int j = 0; j < 4 && removable; j++)
+            removable = this->quadNodes.at(firstChild + j).firstChild == LooseQuadNode::NO_CHILDREN &&
+                this->quadNodes.at(firstChild + j).numElements == 0;
+
+        if (removable)
+        {
+            /* Remove all four children in reverse order so the memory vacancies can be reclaimed
+             * in subsequent iterations in proper order. */
+            this->quadNodes.erase(firstChild + 3);
+            this->quadNodes.erase(firstChild + 2);
+            this->quadNodes.erase(firstChild + 1);
+            this->quadNodes.erase(firstChild);
+
+            this->quadNodes.at(nodeIndex).firstChild = LooseQuadNode::NO_CHILDREN;
+        }
+    }
+}
+
+template<typename CoordType>
+void LooseQuadTree<CoordType>::query(FreeList<QuadTreeCollider<CoordType>*>* output, CoordType top, CoordType bottom,
+    CoordType left, CoordType right) const
+{
+    FreeList<QuadNodeData<CoordType>> toProcess;
+
+    pushBackNode(&toProcess, this->rootNodeIndex, 0, this->topBound, this->bottomBound, this->leftBound, this->rightBound);
+
+    while (toProcess.size())
+    {
+        const QuadNodeData<CoordType> data = toProcess.at(toProcess.size() - 1);
+        const LooseQuadNode& node = this->quadNodes.at(data.quadNodeIndex);
+
+        toProcess.popBack();
+
+        /* Every collider lies within the loose boundaries of its node, so no collider is seen twice. */
+        for (int element = node.firstElement; element != ElementNode::NONE; element = this->elementNodes.at(element).next)
+        {
+            const int colliderIndex = this->elementNodes.at(element).colliderIndex;
+
+            if (overlaps(this->colliderTops[colliderIndex], this->colliderBottoms[colliderIndex],
+                this->colliderLefts[colliderIndex], this->colliderRights[colliderIndex], top, bottom, left, right))
+                output->at(output->pushBack()) = this->colliders.at(colliderIndex);
+        }
+
+        if (node.firstChild == LooseQuadNode::NO_CHILDREN)
+            continue;
+
+        for (int i = 0; i < 4; i++)
+        {
+            const QuadNodeData<CoordType> child = childNodeData(data, node.firstChild, i);
+            const CoordType marginX = this->looseMargin(child.left, child.right),
+                marginY = this->looseMargin(child.bottom, child.top);
+
+            if (child.left - marginX <= right && child.right + marginX >= left &&
+                child.top + marginY >= bottom && child.bottom - marginY <= top)
+                toProcess.at(toProcess.pushBack()) = child;
+        }
+    }
+}
+
+template<typename CoordType>
+CoordType LooseQuadTree<CoordType>::looseMargin(CoordType low, CoordType high) const
+{
+    return (CoordType)((high - low) * (this->looseness - 1.0) / 2.0);
+}
+
+template<typename CoordType>
+QuadNodeData<CoordType> LooseQuadTree<CoordType>::findNode(int colliderIndex) const
+{
+    const CoordType top = this->colliderTops[colliderIndex], bottom = this->colliderBottoms[colliderIndex],
+        left = this->colliderLefts[colliderIndex], right = this->colliderRights[colliderIndex],
+        centreX = quadMidpoint(left, right), centreY = quadMidpoint(bottom, top);
+
+    QuadNodeData<CoordType> data(this->rootNodeIndex, 0, this->topBound, this->bottomBound, this->leftBound, this->rightBound);
+
+    /* Descend into the child containing the centre for as long as the collider fits in its loose boundaries.
+     * Colliders that fit nowhere else stay in the root. */
+    while (data.depth < this->maxDivisions)
+    {
+        const int firstChild = this->quadNodes.at(data.quadNodeIndex).firstChild;
+
+        if (firstChild == LooseQuadNode::NO_CHILDREN)
+            break;
+
+        const int childNumber = (centreX >= quadMidpoint(data.left, data.right) ? 1 : 0) +
+            (centreY < quadMidpoint(data.bottom, data.top) ? 2 : 0);
+
+        const QuadNodeData<CoordType> child = childNodeData(data, firstChild, childNumber);
+        const CoordType marginX = this->looseMargin(child.left, child.right),
+            marginY = this->looseMargin(child.bottom, child.top);
+
+        if (left < child.left - marginX || right > child.right + marginX ||
+            bottom < child.bottom - marginY || top > child.top + marginY)
+            break;
+
+        data = child;
+    }
+
+    return data;
+}
+
+template<typename CoordType>
+void LooseQuadTree<CoordType>::setBounds(int colliderIndex, const QuadTreeCollider<CoordType>& bounds)
+{
+    /* The collider freelist only grows one index at a time, so growing the arrays to its size suffices. */
+    if ((int)this->colliderTops.size() <= colliderIndex)
+    {
+        const int newSize = this->colliders.size();
+
+        this->colliderTops.resize(newSize);
+        this->colliderBottoms.resize(newSize);
+        this->colliderLefts.resize(newSize);
+        this->colliderRights.resize(newSize);
+        this->colliderNodes.resize(newSize);
+        this->colliderElements.resize(newSize);
+    }
+
+    this->colliderTops[colliderIndex] = bounds.top;
+    this->colliderBottoms[colliderIndex] = bounds.bottom;
+    this->colliderLefts[colliderIndex] = bounds.left;
+    this->colliderRights[colliderIndex] = bounds.right;
+}
+
+template<typename CoordType>
+void LooseQuadTree<CoordType>::nodeInsert(int colliderIndex, const QuadNodeData<CoordType>& data)
+{
+    const int newElementIndex = this->elementNodes.insert();
+
+    this->elementNodes.at(newElementIndex).colliderIndex = colliderIndex;
+    this->colliderElements[colliderIndex] = newElementIndex;
+    this->linkElement(newElementIndex, data.quadNodeIndex);
+
+    LooseQuadNode& node = this->quadNodes.at(data.quadNodeIndex);
+
+    /* Only leaves are subdivided. A branch keeps the colliders that fit in none of its children. */
+    if (node.numElements > this->maxEltsPerNode && node.firstChild == LooseQuadNode::NO_CHILDREN &&
+        data.depth < this->maxDivisions)
+        this->subdivideNode(data);
+}
+
+template<typename CoordType>
+void LooseQuadTree<CoordType>::linkElement(int elementIndex, int quadNodeIndex)
+{
+    /* The element node freelist only grows one index at a time, so growing the array to its size suffices. */
+    if ((int)this->elementPrevious.size() < this->elementNodes.size())
+        this->elementPrevious.resize(this->elementNodes.size());
+
+    LooseQuadNode& node = this->quadNodes.at(quadNodeIndex);
+
+    this->elementNodes.at(elementIndex).next = node.firstElement;
+    this->elementPrevious[elementIndex] = ElementNode::NONE;
+
+    if (node.firstElement != ElementNode::NONE)
+        this->elementPrevious[node.firstElement] = elementIndex;
+
+    node.firstElement = elementIndex;
+    node.numElements++;
+    this->colliderNodes[this->elementNodes.at(elementIndex).colliderIndex] = quadNodeIndex;
+}
+
+template<typename CoordType>
+void LooseQuadTree<CoordType>::nodeRemove(int colliderIndex)
+{
+    const int nodeIndex = this->colliderNodes[colliderIndex], element = this->colliderElements[colliderIndex];
+    const int previous = this->elementPrevious[element], next = this->elementNodes.at(element).next;
+
+    if (previous == ElementNode::NONE)
+        this->quadNodes.at(nodeIndex).firstElement = next;
+    else
+        this->elementNodes.at(previous).next = next;
+
+    if (next != ElementNode::NONE)
+        this->elementPrevious[next] = previous;
+
+    this->elementNodes.erase(element);
+    this->quadNodes.at(nodeIndex).numElements--;
+}
+
+template<typename CoordType>
+void LooseQuadTree<CoordType>::subdivideNode(const QuadNodeData<CoordType>& data)
+{
+    const int firstChild = this->quadNodes.insert();
+
+    this->quadNodes.insert();
+    this->quadNodes.insert();
+    this->quadNodes.insert();
+
+    for (int i = 0; i < 4; i++)
+        this->quadNodes.at(firstChild + i) = LooseQuadNode();
+
+    LooseQuadNode& node = this->quadNodes.at(data.quadNodeIndex);
+    int element = node.firstElement;
+
+    node.firstChild = firstChild;
+    node.firstElement = ElementNode::NONE;
+    node.numElements = 0;
+
+    /* Relink every element either into the node again or into the child it now fits in. The element
+     * nodes themselves are reused. */
+    while (element != ElementNode::NONE)
+    {
+        const int next = this->elementNodes.at(element).next;
+
+        this->linkElement(element, this->findNode(this->elementNodes.at(element).colliderIndex).quadNodeIndex);
+
+        element = next;
+    }
+
+    /* Children that received too many elements are subdivided in turn. */
+    for (int i = 0; i < 4; i++)
+    {
+        const QuadNodeData<CoordType> child = childNodeData(data, firstChild, i);
+
+        if (this->quadNodes.at(child.quadNodeIndex).numElements > this->maxEltsPerNode && child.depth < this->maxDivisions)
+            this->subdivideNode(child);
+    }
+}
+
+#endif
\ No newline at end of file
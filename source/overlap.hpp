@@ -0,0 +1,217 @@
+#ifndef OVERLAP_HPP_INCLUDED
+#define OVERLAP_HPP_INCLUDED
+
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__AVX__)
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+#endif
+
+/* Tests batches of boxes stored as separate top, bottom, left and right arrays against a single pair of
+ * boundaries. Vector implementations are used for the coordinate types and instruction sets the compiler
+ * targets, with a scalar fallback otherwise. */
+
+/* Returns whether a single box overlaps the boundaries. */
+template<typename CoordType>
+inline bool overlaps(CoordType boxTop, CoordType boxBottom, CoordType boxLeft, CoordType boxRight,
+    CoordType top, CoordType bottom, CoordType left, CoordType right)
+{
+    return boxLeft <= right && boxRight >= left && boxTop >= bottom && boxBottom <= top;
+}
+
+/* Computes which boxes of a batch overlap the boundaries. The generic version tests one box at a time. */
+template<typename CoordType>
+struct OverlapKernel
+{
+    static const int BATCH_SIZE = 4;
+
+    /* Returns a bit mask of the boxes in [index, index + BATCH_SIZE) that overlap the boundaries. */
+    static int mask(const CoordType* tops, const CoordType* bottoms, const CoordType* lefts, const CoordType* rights,
+        int index, CoordType top, CoordType bottom, CoordType left, CoordType right)
+    {
+        int result = 0;
+
+        for (int i = 0; i < BATCH_SIZE; i++)
+            result |= (int)overlaps(tops[index + i], bottoms[index + i], lefts[index + i], rights[index + i],
+                top, bottom, left, right) << i;
+
+        return result;
+    }
+};
+
+#if defined(__SSE2__) || defined(_M_X64)
+/* Packs a byte mask in which each 16 bit lane set both of its bits into one bit per lane. */
+inline int compressLaneMask16(unsigned int byteMask)
+{
+    byteMask &= 0x55555555u;
+    byteMask = (byteMask | (byteMask >> 1)) & 0x33333333u;
+    byteMask = (byteMask | (byteMask >> 2)) & 0x0F0F0F0Fu;
+    byteMask = (byteMask | (byteMask >> 4)) & 0x00FF00FFu;
+    byteMask = (byteMask | (byteMask >> 8)) & 0x0000FFFFu;
+
+    return (int)byteMask;
+}
+
+/* In every kernel below, a box is rejected if it lies entirely beyond any one of the four boundaries. */
+
+template<>
+struct OverlapKernel<std::int32_t>
+{
+#if defined(__AVX2__)
+    static const int BATCH_SIZE = 8;
+
+    static int mask(const std::int32_t* tops, const std::int32_t* bottoms, const std::int32_t* lefts,
+        const std::int32_t* rights, int index, std::int32_t top, std::int32_t bottom, std::int32_t left, std::int32_t right)
+    {
+        __m256i outside = _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i*)(lefts + index)), _mm256_set1_epi32(right));
+        outside = _mm256_or_si256(outside, _mm256_cmpgt_epi32(_mm256_set1_epi32(left), _mm256_loadu_si256((const __m256i*)(rights + index))));
+        outside = _mm256_or_si256(outside, _mm256_cmpgt_epi32(_mm256_set1_epi32(bottom), _mm256_loadu_si256((const __m256i*)(tops + index))));
+        outside = _mm256_or_si256(outside, _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i*)(bottoms + index)), _mm256_set1_epi32(top)));
+
+        return ~_mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xFF;
+    }
+#else
+    static const int BATCH_SIZE = 4;
+
+    static int mask(const std::int32_t* tops, const std::int32_t* bottoms, const std::int32_t* lefts,
+        const std::int32_t* rights, int index, std::int32_t top, std::int32_t bottom, std::int32_t left, std::int32_t right)
+    {
+        __m128i outside = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)(lefts + index)), _mm_set1_epi32(right));
+        outside = _mm_or_si128(outside, _mm_cmpgt_epi32(_mm_set1_epi32(left), _mm_loadu_si128((const __m128i*)(rights + index))));
+        outside = _mm_or_si128(outside, _mm_cmpgt_epi32(_mm_set1_epi32(bottom), _mm_loadu_si128((const __m128i*)(tops + index))));
+        outside = _mm_or_si128(outside, _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)(bottoms + index)), _mm_set1_epi32(top)));
+
+        return ~_mm_movemask_ps(_mm_castsi128_ps(outside)) & 0xF;
+    }
+#endif
+};
+
+template<>
+struct OverlapKernel<std::int16_t>
+{
+#if defined(__AVX2__)
+    static const int BATCH_SIZE = 16;
+
+    static int mask(const std::int16_t* tops, const std::int16_t* bottoms, const std::int16_t* lefts,
+        const std::int16_t* rights, int index, std::int16_t top, std::int16_t bottom, std::int16_t left, std::int16_t right)
+    {
+        __m256i outside = _mm256_cmpgt_epi16(_mm256_loadu_si256((const __m256i*)(lefts + index)), _mm256_set1_epi16(right));
+        outside = _mm256_or_si256(outside, _mm256_cmpgt_epi16(_mm256_set1_epi16(left), _mm256_loadu_si256((const __m256i*)(rights + index))));
+        outside = _mm256_or_si256(outside, _mm256_cmpgt_epi16(_mm256_set1_epi16(bottom), _mm256_loadu_si256((const __m256i*)(tops + index))));
+        outside = _mm256_or_si256(outside, _mm256_cmpgt_epi16(_mm256_loadu_si256((const __m256i*)(bottoms + index)), _mm256_set1_epi16(top)));
+
+        return ~compressLaneMask16((unsigned int)_mm256_movemask_epi8(outside)) & 0xFFFF;
+    }
+#else
+    static const int BATCH_SIZE = 8;
+
+    static int mask(const std::int16_t* tops, const std::int16_t* bottoms, const std::int16_t* lefts,
+        const std::int16_t* rights, int index, std::int16_t top, std::int16_t bottom, std::int16_t left, std::int16_t right)
+    {
+        __m128i outside = _mm_cmpgt_epi16(_mm_loadu_si128((const __m128i*)(lefts + index)), _mm_set1_epi16(right));
+        outside = _mm_or_si128(outside, _mm_cmpgt_epi16(_mm_set1_epi16(left), _mm_loadu_si128((const __m128i*)(rights + index))));
+        outside = _mm_or_si128(outside, _mm_cmpgt_epi16(_mm_set1_epi16(bottom), _mm_loadu_si128((const __m128i*)(tops + index))));
+        outside = _mm_or_si128(outside, _mm_cmpgt_epi16(_mm_loadu_si128((const __m128i*)(bottoms + index)), _mm_set1_epi16(top)));
+
+        return ~compressLaneMask16((unsigned int)_mm_movemask_epi8(outside)) & 0xFF;
+    }
+#endif
+};
+
+template<>
+struct OverlapKernel<float>
+{
+#if defined(__AVX__)
+    static const int BATCH_SIZE = 8;
+
+    static int mask(const float* tops, const float* bottoms, const float* lefts, const float* rights, int index,
+        float top, float bottom, float left, float right)
+    {
+        __m256 outside = _mm256_cmp_ps(_mm256_loadu_ps(lefts + index), _mm256_set1_ps(right), _CMP_GT_OQ);
+        outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_set1_ps(left), _mm256_loadu_ps(rights + index), _CMP_GT_OQ));
+        outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_set1_ps(bottom), _mm256_loadu_ps(tops + index), _CMP_GT_OQ));
+        outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_loadu_ps(bottoms + index), _mm256_set1_ps(top), _CMP_GT_OQ));
+
+        return ~_mm256_movemask_ps(outside) & 0xFF;
+    }
+#else
+    static const int BATCH_SIZE = 4;
+
+    static int mask(const float* tops, const float* bottoms, const float* lefts, const float* rights, int index,
+        float top, float bottom, float left, float right)
+    {
+        __m128 outside = _mm_cmpgt_ps(_mm_loadu_ps(lefts + index), _mm_set1_ps(right));
+        outside = _mm_or_ps(outside, _mm_cmpgt_ps(_mm_set1_ps(left), _mm_loadu_ps(rights + index)));
+        outside = _mm_or_ps(outside, _mm_cmpgt_ps(_mm_set1_ps(bottom), _mm_loadu_ps(tops + index)));
+        outside = _mm_or_ps(outside, _mm_cmpgt_ps(_mm_loadu_ps(bottoms + index), _mm_set1_ps(top)));
+
+        return ~_mm_movemask_ps(outside) & 0xF;
+    }
+#endif
+};
+
+template<>
+struct OverlapKernel<double>
+{
+#if defined(__AVX__)
+    static const int BATCH_SIZE = 4;
+
+    static int mask(const double* tops, const double* bottoms, const double* lefts, const double* rights, int index,
+        double top, double bottom, double left, double right)
+    {
+        __m256d outside = _mm256_cmp_pd(_mm256_loadu_pd(lefts + index), _mm256_set1_pd(right), _CMP_GT_OQ);
+        outside = _mm256_or_pd(outside, _mm256_cmp_pd(_mm256_set1_pd(left), _mm256_loadu_pd(rights + index), _CMP_GT_OQ));
+        outside = _mm256_or_pd(outside, _mm256_cmp_pd(_mm256_set1_pd(bottom), _mm256_loadu_pd(tops + index), _CMP_GT_OQ));
+        outside = _mm256_or_pd(outside, _mm256_cmp_pd(_mm256_loadu_pd(bottoms + index), _mm256_set1_pd(top), _CMP_GT_OQ));
+
+        return ~_mm256_movemask_pd(outside) & 0xF;
+    }
+#else
+    static const int BATCH_SIZE = 2;
+
+    static int mask(const double* tops, const double* bottoms, const double* lefts, const double* rights, int index,
+        double top, double bottom, double left, double right)
+    {
+        __m128d outside = _mm_cmpgt_pd(_mm_loadu_pd(lefts + index), _mm_set1_pd(right));
+        outside = _mm_or_pd(outside, _mm_cmpgt_pd(_mm_set1_pd(left), _mm_loadu_pd(rights + index)));
+        outside = _mm_or_pd(outside, _mm_cmpgt_pd(_mm_set1_pd(bottom), _mm_loadu_pd(tops + index)));
+        outside = _mm_or_pd(outside, _mm_cmpgt_pd(_mm_loadu_pd(bottoms + index), _mm_set1_pd(top)));
+
+        return ~_mm_movemask_pd(outside) & 0x3;
+    }
+#endif
+};
+#endif
+
+/* Calls the callback with the index of every box in [first, last) that overlaps the boundaries. The callback
+ * returns false to stop early, in which case false is returned. */
+template<typename CoordType, typename Callback>
+inline bool forEachOverlap(const CoordType* tops, const CoordType* bottoms, const CoordType* lefts, const CoordType* rights,
+    int first, int last, CoordType top, CoordType bottom, CoordType left, CoordType right, Callback callback)
+{
+    const int batchSize = OverlapKernel<CoordType>::BATCH_SIZE;
+    int index = first;
+
+    for (; index + batchSize <= last; index += batchSize)
+    {
+        const int mask = OverlapKernel<CoordType>::mask(tops, bottoms, lefts, rights, index, top, bottom, left, right);
+
+        if (mask == 0)
+            continue;
+
+        for (int i = 0; i < batchSize; i++)
+            if ((mask & (1 << i)) && !callback(index + i))
+                return false;
+    }
+
+    /* Test the remainder one box at a time. */
+    for (; index < last; index++)
+        if (overlaps(tops[index], bottoms[index], lefts[index], rights[index], top, bottom, left, right) && !callback(index))
+            return false;
+
+    return true;
+}
+
+#endif
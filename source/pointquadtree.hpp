@@ -0,0 +1,92 @@
+#ifndef POINT_QUADTREE_HPP_INCLUDED
+#define POINT_QUADTREE_HPP_INCLUDED
+
+#include <vector>
+
+#include "quadtree.hpp"
+
+/* A quadtree of points. A point lies in exactly one leaf, found by choosing a single quadrant at every level,
+ * so no point is stored twice and queries need no deduplication. The points are linked into the lists of their
+ * leaves directly, without element nodes. */
+template<typename CoordType = int>
+class PointQuadTree
+{
+public:
+    PointQuadTree(CoordType top, CoordType bottom, CoordType left, CoordType right, int maxDivisions, int maxEltsPerNode);
+
+    /* Inserts the point into the quadtree. */
+    int insert(QuadTreePoint<CoordType>* point);
+
+    /* Removes the point from the quadtree. The position it was last inserted or updated with is used. */
+    void remove(const QuadTreePoint<CoordType>* point, int pointIndex);
+
+    /* Moves an inserted point to the given position. Returns immediately if it stays in the same leaf. */
+    void update(int pointIndex, CoordType x, CoordType y);
+
+    /* Clears the quadtree of all inserted points. */
+    void clearElements();
+
+    /* Merges every group of four leaves that together hold no more than maxEltsPerNode points. */
+    void cleanup();
+
+    /* Populates the freelist with the pointers to the points inside the boundaries. */
+    void query(FreeList<QuadTreePoint<CoordType>*>* output, CoordType top, CoordType bottom, CoordType left,
+        CoordType right) const;
+
+    /* Populates the freelist with the pointers to the points no farther than the radius from the given centre. */
+    void queryRadius(FreeList<QuadTreePoint<CoordType>*>* output, CoordType x, CoordType y, CoordType radius) const;
+
+    /* Calls the visitor with the pointer to every point inside the boundaries. The visitor returns false to stop
+     * the query early, in which case false is returned. Safe to call from several threads while the quadtree is
+     * not modified. */
+    template<typename Visitor>
+    bool queryVisit(CoordType top, CoordType bottom, CoordType left, CoordType right, Visitor visitor) const;
+
+    /* Calls the visitor with the pointer to every point no farther than the radius from the given centre, as
+     * queryVisit does. */
+    template<typename Visitor>
+    bool queryRadiusVisit(CoordType x, CoordType y, CoordType radius, Visitor visitor) const;
+
+    FreeList<QuadTreePoint<CoordType>*> points;
+    FreeList<QuadNode> quadNodes;
+
+#ifndef NO_PRIVATE
+    private:
+#endif
+    CoordType topBound, bottomBound, leftBound, rightBound;
+
+    int maxDivisions, maxEltsPerNode;
+
+    int rootNodeIndex;
+
+    /* Copies of the point positions and the next point in the same leaf, indexed by point index. The first point
+     * of a leaf is its firstChild. */
+    std::vector<CoordType> pointXs, pointYs;
+    std::vector<int> pointNexts;
+
+    /* Returns whether the position lies within the half-open boundaries of the quadtree. */
+    bool contains(CoordType x, CoordType y) const;
+
+    /* Returns the data of the leaf containing the given position, which must lie within the quadtree. */
+    QuadNodeData<CoordType> findLeaf(CoordType x, CoordType y) const;
+
+    /* Stores the position of the given point index. */
+    void setPosition(int pointIndex, CoordType x, CoordType y);
+
+    /* Links the given point index into the given leaf, subdividing it if needed and allowed. */
+    void nodeInsert(int pointIndex, const QuadNodeData<CoordType>& data);
+
+    /* Unlinks the given point index from the given leaf. */
+    void nodeRemove(int pointIndex, int quadNodeIndex);
+
+    /* Turns the given leaf into a branch and moves its points down to the new children. */
+    void subdivideNode(const QuadNodeData<CoordType>& data);
+
+    /* Calls the visitor with every point of the leaf that passes the test, as queryVisit does. */
+    template<typename Test, typename Visitor>
+    bool visitLeaf(int quadNodeIndex, Test test, Visitor visitor) const;
+};
+
+#include "pointquadtree.inl"
+
+#endif
@@ -0,0 +1,420 @@
+#ifndef POINT_QUADTREE_INL_INCLUDED
+#define POINT_QUADTREE_INL_INCLUDED
+
+template<typename CoordType>
+PointQuadTree<CoordType>::PointQuadTree(CoordType top, CoordType bottom, CoordType left, CoordType right,
+    int maxDivisions, int maxEltsPerNode)
+    : topBound(top), bottomBound(bottom), leftBound(left), rightBound(right),
+      maxDivisions(maxDivisions), maxEltsPerNode(maxEltsPerNode)
+{
+    this->rootNodeIndex = this->quadNodes.insert();
+    this->quadNodes.at(this->rootNodeIndex) = QuadNode(ElementNode::NONE, 0);
+}
+
+template<typename CoordType>
+int PointQuadTree<CoordType>::insert(QuadTreePoint<CoordType>* point)
+{
+    const int pointIndex = this->points.insert();
+
+    this->points.at(pointIndex) = point;
+    this->setPosition(pointIndex, point->x, point->y);
+
+    /* Points outside the quadtree are kept, but belong to no leaf. */
+    if (this->contains(point->x, point->y))
+        this->nodeInsert(pointIndex, this->findLeaf(point->x, point->y));
+
+    return pointIndex;
+}
+
+template<typename CoordType>
+void PointQuadTree<CoordType>::remove(const QuadTreePoint<CoordType>* point, int pointIndex)
+{
+    assert(this->points.at(pointIndex) == point);
+    (void)point;
+
+    const CoordType x = this->pointXs[pointIndex], y = this->pointYs[pointIndex];
+
+    if (this->contains(x, y))
+        this->nodeRemove(pointIndex, this->findLeaf(x, y).quadNodeIndex);
+
+    this->points.erase(pointIndex);
+}
+
+template<typename CoordType>
+void PointQuadTree<CoordType>::update(int pointIndex, CoordType x, CoordType y)
+{
+    const CoordType oldX = this->pointXs[pointIndex], oldY = this->pointYs[pointIndex];
+    const bool wasInside = this->contains(oldX, oldY), isInside = this->contains(x, y);
+    const int oldLeaf = wasInside ? this->findLeaf(oldX, oldY).quadNodeIndex : ElementNode::NONE;
+
+    this->setPosition(pointIndex, x, y);
+
+    if (!isInside)
+    {
+        if (wasInside)
+            this->nodeRemove(pointIndex, oldLeaf);
+
+        return;
+    }
+
+    const QuadNodeData<CoordType> target = this->findLeaf(x, y);
+
+    if (target.quadNodeIndex == oldLeaf)
+        return;
+
+    if (wasInside)
+        this->nodeRemove(pointIndex, oldLeaf);
+
+    this->nodeInsert(pointIndex, target);
+}
+
+template<typename CoordType>
+void PointQuadTree<CoordType>::clearElements()
+{
+    this->points.clear();
+
+    FreeList<int> toProcess;
+
+    toProcess.at(toProcess.pushBack()) = this->rootNodeIndex;
+
+    /* The branches are kept, because they will most likely be needed again soon. */
+    while (toProcess.size())
+    {
+        QuadNode& node = this->quadNodes.at(toProcess.at(toProcess.size() - 1));
+
+        toProcess.popBack();
+
+        if (node.numElements == QuadNode::BRANCH_NODE)
+        {
+            for (int i = 0; i < 4; i++)
+                toProcess.at(toProcess.pushBack()) = node.firstChild + i;
+
+            continue;
+        }
+
+        node.firstChild = ElementNode::NONE;
+        node.numElements = 0;
+    }
+}
+
+template<typename CoordType>
+void PointQuadTree<CoordType>::cleanup()
+{
+    FreeList<int> toProcess, branches;
+
+    toProcess.at(toProcess.pushBack()) = this->rootNodeIndex;
+
+    /* Collect the branches in pre-order, so that walking the list backwards visits children first. */
+    while (toProcess.size())
+    {
+        const int nodeIndex = toProcess.at(toProcess.size() - 1);
+        const QuadNode& node = this->quadNodes.at(nodeIndex);
+
+        toProcess.popBack();
+
+        if (node.numElements != QuadNode::BRANCH_NODE)
+            continue;
+
+        branches.at(branches.pushBack()) = nodeIndex;
+
+        for (int i = 0; i < 4; i++)
+            toProcess.at(toProcess.pushBack()) = node.firstChild + i;
+    }
+
+    for (int i = branches.size() - 1; i >= 0; i--)
+    {
+        const int nodeIndex = branches.at(i), firstChild = this->quadNodes.at(nodeIndex).firstChild;
+        int numPoints = 0;
+
+        for (int j = 0; j < 4 && numPoints <= this->maxEltsPerNode; j++)
+        {
+            const int numElements = this->quadNodes.at(firstChild + j).numElements;
+
+            numPoints = numElements == QuadNode::BRANCH_NODE ? this->maxEltsPerNode + 1 : numPoints + numElements;
+        }
+
+        if (numPoints > this->maxEltsPerNode)
+            continue;
+
+        /* A point lies in a single leaf, so the children's lists are joined without checking for duplicates. */
+        int head = ElementNode::NONE;
+
+        for (int j = 3; j >= 0; j--)
+        {
+            for (int point = this->quadNodes.at(firstChild + j).firstChild; point != ElementNode::NONE; )
+            {
+                const int next = this->pointNexts[point];
+
+                this->pointNexts[point] = head;
+                head = point;
+                point = next;
+            }
+        }
+
+        /* Remove all four children in reverse order so the memory vacancies can be reclaimed
+         * in subsequent iterations in proper order. */
+        this->quadNodes.erase(firstChild + 3);
+        this->quadNodes.erase(firstChild + 2);
+        this->quadNodes.erase(firstChild + 1);
+        this->quadNodes.erase(firstChild);
+
+        this->quadNodes.at(nodeIndex) = QuadNode(head, numPoints);
+    }
+}
+
+template<typename CoordType>
+void PointQuadTree<CoordType>::query(FreeList<QuadTreePoint<CoordType>*>* output, CoordType top, CoordType bottom,
+    CoordType left, CoordType right) const
+{
+    this->queryVisit(top, bottom, left, right, [output](QuadTreePoint<CoordType>* point)
+    {
+        output->at(output->pushBack()) = point;
+        return true;
+    });
+}
+
+template<typename CoordType>
+void PointQuadTree<CoordType>::queryRadius(FreeList<QuadTreePoint<CoordType>*>* output, CoordType x, CoordType y,
+    CoordType radius) const
+{
+    this->queryRadiusVisit(x, y, radius, [output](QuadTreePoint<CoordType>* point)
+    {
+        output->at(output->pushBack()) = point;
+        return true;
+    });
+}
+
+template<typename CoordType>
+template<typename Visitor>
+bool PointQuadTree<CoordType>::queryVisit(CoordType top, CoordType bottom, CoordType left, CoordType right,
+    Visitor visitor) const
+{
+    /* Return early if the boundaries do not overlap the quadtree. */
+    if (this->topBound <= bottom || this->bottomBound > top || this->rightBound <= left || this->leftBound > right)
+        return true;
+
+    FreeList<QuadNodeData<CoordType>> toProcess;
+
+    pushBackNode(&toProcess, this->rootNodeIndex, 0, this->topBound, this->bottomBound, this->leftBound, this->rightBound);
+
+    while (toProcess.size())
+    {
+        const QuadNodeData<CoordType> data = toProcess.at(toProcess.size() - 1);
+        const QuadNode& node = this->quadNodes.at(data.quadNodeIndex);
+
+        toProcess.popBack();
+
+        if (node.numElements == QuadNode::BRANCH_NODE)
+        {
+            const CoordType halfX = quadMidpoint(data.left, data.right), halfY = quadMidpoint(data.bottom, data.top);
+
+            if (left < halfX)
+            {
+                /* Top left. */
+                if (top >= halfY)
+                    pushBackNode(&toProcess, node.firstChild, data.depth + 1, data.top, halfY, data.left, halfX);
+                /* Bottom left. */
+                if (bottom < halfY)
+                    pushBackNode(&toProcess, node.firstChild + 2, data.depth + 1, halfY, data.bottom, data.left, halfX);
+            }
+            if (right >= halfX)
+            {
+                /* Top right. */
+                if (top >= halfY)
+                    pushBackNode(&toProcess, node.firstChild + 1, data.depth + 1, data.top, halfY, halfX, data.right);
+                /* Bottom right. */
+                if (bottom < halfY)
+                    pushBackNode(&toProcess, node.firstChild + 3, data.depth + 1, halfY, data.bottom, halfX, data.right);
+            }
+
+            continue;
+        }
+
+        const bool visited = this->visitLeaf(data.quadNodeIndex, [&](CoordType pointX, CoordType pointY)
+        {
+            return pointX >= left && pointX <= right && pointY >= bottom && pointY <= top;
+        }, visitor);
+
+        if (!visited)
+            return false;
+    }
+
+    return true;
+}
+
+template<typename CoordType>
+template<typename Visitor>
+bool PointQuadTree<CoordType>::queryRadiusVisit(CoordType x, CoordType y, CoordType radius, Visitor visitor) const
+{
+    const double cutoff = (double)radius * radius;
+
+    if (radius < 0 || boxDistanceSquared(x, y, this->topBound, this->bottomBound, this->leftBound, this->rightBound) > cutoff)
+        return true;
+
+    FreeList<QuadNodeData<CoordType>> toProcess;
+
+    pushBackNode(&toProcess, this->rootNodeIndex, 0, this->topBound, this->bottomBound, this->leftBound, this->rightBound);
+
+    while (toProcess.size())
+    {
+        const QuadNodeData<CoordType> data = toProcess.at(toProcess.size() - 1);
+        const QuadNode& node = this->quadNodes.at(data.quadNodeIndex);
+
+        toProcess.popBack();
+
+        if (node.numElements == QuadNode::BRANCH_NODE)
+        {
+            /* Only children whose boundaries come within the radius can hold a point inside the circle. */
+            for (int i = 0; i < 4; i++)
+            {
+                const QuadNodeData<CoordType> child = childNodeData(data, node.firstChild, i);
+
+                if (boxDistanceSquared(x, y, child.top, child.bottom, child.left, child.right) <= cutoff)
+                    toProcess.at(toProcess.pushBack()) = child;
+            }
+
+            continue;
+        }
+
+        const bool visited = this->visitLeaf(data.quadNodeIndex, [&](CoordType pointX, CoordType pointY)
+        {
+            const double dx = (double)pointX - x, dy = (double)pointY - y;
+
+            return dx * dx + dy * dy <= cutoff;
+        }, visitor);
+
+        if (!visited)
+            return false;
+    }
+
+    return true;
+}
+
+template<typename CoordType>
+bool PointQuadTree<CoordType>::contains(CoordType x, CoordType y) const
+{
+    return x >= this->leftBound && x < this->rightBound && y >= this->bottomBound && y < this->topBound;
+}
+
+template<typename CoordType>
+QuadNodeData<CoordType> PointQuadTree<CoordType>::findLeaf(CoordType x, CoordType y) const
+{
+    QuadNodeData<CoordType> data(this->rootNodeIndex, 0, this->topBound, this->bottomBound, this->leftBound, this->rightBound);
+
+    /* A point lies in a single child of every branch, so one quadrant is chosen per level. */
+    while (this->quadNodes.at(data.quadNodeIndex).numElements == QuadNode::BRANCH_NODE)
+    {
+        const int childNumber = (x >= quadMidpoint(data.left, data.right) ? 1 : 0) +
+            (y < quadMidpoint(data.bottom, data.top) ? 2 : 0);
+
+        data = childNodeData(data, this->quadNodes.at(data.quadNodeIndex).firstChild, childNumber);
+    }
+
+    return data;
+}
+
+template<typename CoordType>
+void PointQuadTree<CoordType>::setPosition(int pointIndex, CoordType x, CoordType y)
+{
+    /* The point freelist only grows one index at a time, so growing the arrays to its size suffices. */
+    if ((int)this->pointXs.size() <= pointIndex)
+    {
+        const int newSize = this->points.size();
+
+        this->pointXs.resize(newSize);
+        this->pointYs.resize(newSize);
+        this->pointNexts.resize(newSize);
+    }
+
+    this->pointXs[pointIndex] = x;
+    this->pointYs[pointIndex] = y;
+}
+
+template<typename CoordType>
+void PointQuadTree<CoordType>::nodeInsert(int pointIndex, const QuadNodeData<CoordType>& data)
+{
+    QuadNode& node = this->quadNodes.at(data.quadNodeIndex);
+
+    this->pointNexts[pointIndex] = node.firstChild;
+    node.firstChild = pointIndex;
+
+    if (++node.numElements > this->maxEltsPerNode && data.depth < this->maxDivisions)
+        this->subdivideNode(data);
+}
+
+template<typename CoordType>
+void PointQuadTree<CoordType>::nodeRemove(int pointIndex, int quadNodeIndex)
+{
+    QuadNode& node = this->quadNodes.at(quadNodeIndex);
+    int previous = ElementNode::NONE, current = node.firstChild;
+
+    while (current != pointIndex)
+    {
+        previous = current;
+        current = this->pointNexts[current];
+    }
+
+    if (previous == ElementNode::NONE)
+        node.firstChild = this->pointNexts[pointIndex];
+    else
+        this->pointNexts[previous] = this->pointNexts[pointIndex];
+
+    node.numElements--;
+}
+
+template<typename CoordType>
+void PointQuadTree<CoordType>::subdivideNode(const QuadNodeData<CoordType>& data)
+{
+    const int firstChild = this->quadNodes.insert();
+
+    this->quadNodes.insert();
+    this->quadNodes.insert();
+    this->quadNodes.insert();
+
+    for (int i = 0; i < 4; i++)
+        this->quadNodes.at(firstChild + i) = QuadNode(ElementNode::NONE, 0);
+
+    const CoordType halfX = quadMidpoint(data.left, data.right), halfY = quadMidpoint(data.bottom, data.top);
+    int point = this->quadNodes.at(data.quadNodeIndex).firstChild;
+
+    this->quadNodes.at(data.quadNodeIndex) = QuadNode(firstChild, QuadNode::BRANCH_NODE);
+
+    /* Relink every point into the single child containing it. */
+    while (point != ElementNode::NONE)
+    {
+        const int next = this->pointNexts[point];
+        QuadNode& child = this->quadNodes.at(firstChild + (this->pointXs[point] >= halfX ? 1 : 0) +
+            (this->pointYs[point] < halfY ? 2 : 0));
+
+        this->pointNexts[point] = child.firstChild;
+        child.firstChild = point;
+        child.numElements++;
+
+        point = next;
+    }
+
+    /* Children that received too many points are subdivided in turn. */
+    for (int i = 0; i < 4; i++)
+    {
+        const QuadNodeData<CoordType> child = childNodeData(data, firstChild, i);
+
+        if (this->quadNodes.at(child.quadNodeIndex).numElements > this->maxEltsPerNode && child.depth < this->maxDivisions)
+            this->subdivideNode(child);
+    }
+}
+
+template<typename CoordType>
+template<typename Test, typename Visitor>
+bool PointQuadTree<CoordType>::visitLeaf(int quadNodeIndex, Test test, Visitor visitor) const
+{
+    for (int point = this->quadNodes.at(quadNodeIndex).firstChild; point != ElementNode::NONE;
+        point = this->pointNexts[point])
+    {
+        if (test(this->pointXs[point], this->pointYs[point]) && !visitor(this->points.at(point)))
+            return false;
+    }
+
+    return true;
+}
+
+#endif
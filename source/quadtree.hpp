@@ -1,9 +1,16 @@
 #ifndef QUADTREE_HPP_INCLUDED
 #define QUADTREE_HPP_INCLUDED
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "freelist.hpp"
+#include "overlap.hpp"
 #include "quadtreecollider.hpp"
 
 /* Stores data about a single node in the quadtree. */
@@ -27,25 +34,310 @@ struct ElementNode
     int next, colliderIndex;
 };
 
+/* Defining QUADTREE_COUNTERS makes queries and subdivisions count the work they do. The counters are compiled out
+ * otherwise. */
+#ifdef QUADTREE_COUNTERS
+    #define QUADTREE_COUNT(counter, amount) ((counter) += (amount))
+#else
+    #define QUADTREE_COUNT(counter, amount) ((void)0)
+#endif
+
+#ifdef QUADTREE_COUNTERS
+/* Counts the work done by queries and subdivisions. */
+struct QuadTreeCounters
+{
+    QuadTreeCounters();
+
+    /* Adds the other counters to these. */
+    void add(const QuadTreeCounters& other);
+
+    /* The number of quadnodes popped from a traversal. */
+    long long nodesVisited;
+
+    /* The number of collider boundaries tested against a query. */
+    long long elementsTested;
+
+    /* The number of colliders skipped because the query had already seen them in another leaf. */
+    long long duplicatesRejected;
+
+    /* The number of nodes split by subdivideNode. */
+    long long subdivisions;
+};
+#endif
+
+/* Reports how much of a freelist is in use. */
+struct FreeListUsage
+{
+    FreeListUsage(int numElements = 0, int size = 0, int capacity = 0);
+
+    /* The number of live elements, the number of slots ever used and the number of slots allocated. */
+    int numElements, size, capacity;
+};
+
+/* Summarises the shape and memory use of a quadtree. */
+struct QuadTreeStats
+{
+    QuadTreeStats();
+
+    /* The number of leaves at each depth, indexed by depth. */
+    std::vector<int> leavesPerDepth;
+
+    /* The number of leaves holding each number of elements, indexed by element count. */
+    std::vector<int> leavesPerElementCount;
+
+    int numBranches, numLeaves, maxDepth;
+
+    /* The number of leaves holding more than maxEltsPerNode elements, which only happens at maxDivisions. */
+    int numOverfullLeaves;
+
+    /* The number of leaves each collider occupies on average. */
+    double averageLeavesPerCollider;
+
+    FreeListUsage colliders, quadNodes, elementNodes;
+
+#ifdef QUADTREE_COUNTERS
+    /* The counters of the quadtree and of its own query context. */
+    QuadTreeCounters counters;
+#endif
+};
+
+/* The header at the start of a quadtree snapshot file. Every array follows it at the given offset from the start
+ * of the file, aligned to SnapshotHeader::ALIGNMENT, so the file can be mapped at any address. */
+struct SnapshotHeader
+{
+    static const std::uint32_t MAGIC = 0x50414E53, VERSION = 1, BYTE_ORDER_MARK = 0x01020304, ALIGNMENT = 64;
+
+    /* Identify the file and the layout it was written with. */
+    std::uint32_t magic, version, byteOrder, coordinateType;
+
+    std::int32_t maxDivisions, maxEltsPerNode, rootNodeIndex;
+
+    /* The number of quadnode, element node and collider slots stored, including vacant ones. */
+    std::int32_t numQuadNodes, numElementNodes, numColliders;
+
+    /* The quadnode and element node arrays, and the bounds array. The latter holds the root top, bottom, left
+     * and right, followed by the collider tops, bottoms, lefts and rights, each numColliders long. */
+    std::uint64_t quadNodesOffset, elementNodesOffset, boundsOffset, fileSize;
+};
+
+/* Returns the code stored in a snapshot for the given coordinate type, from its size and kind. */
+template<typename CoordType>
+inline std::uint32_t snapshotCoordinateType()
+{
+    return (std::uint32_t)sizeof(CoordType) | (std::is_floating_point<CoordType>::value ? 0x100u : 0u) |
+        (std::is_signed<CoordType>::value ? 0x200u : 0u);
+}
+
+/* Reports the memory released by compacting a quadtree. */
+struct CompactionResult
+{
+    CompactionResult(int quadNodesReclaimed = 0, int elementNodesReclaimed = 0, long long bytesReclaimed = 0);
+
+    /* The number of quadnode and element node slots of capacity released. */
+    int quadNodesReclaimed, elementNodesReclaimed;
+
+    /* The number of bytes released by the quadnode and element node lists, the arrays indexed by their slots and
+     * the packed leaves. */
+    long long bytesReclaimed;
+};
+
+/* Returns the coordinate at which a node spanning [low, high) is split. Integer coordinates are halved
+ * with truncation so that both halves cover whole units. */
+template<typename CoordType>
+inline CoordType quadMidpoint(CoordType low, CoordType high)
+{
+    if constexpr (std::is_integral<CoordType>::value)
+        return (CoordType)(low + (high - low) / 2);
+    else
+        return low + (high - low) * (CoordType)0.5;
+}
+
 /* Stores additional data about a single QuadNode. */
+template<typename CoordType>
 struct QuadNodeData
 {
     QuadNodeData();
-    QuadNodeData(int quadNodeIndex, int depth, int top, int bottom, int left, int right);
+    QuadNodeData(int quadNodeIndex, int depth, CoordType top, CoordType bottom, CoordType left, CoordType right);
+
+    int quadNodeIndex, depth;
+    CoordType top, bottom, left, right;
+};
+
+/* Returns the data of a child of the given branch. Children are numbered from zero in the order top left,
+ * top right, bottom left, bottom right, matching their order in the quadnode list. */
+template<typename CoordType>
+inline QuadNodeData<CoordType> childNodeData(const QuadNodeData<CoordType>& parent, int firstChild, int child)
+{
+    const CoordType halfX = quadMidpoint(parent.left, parent.right), halfY = quadMidpoint(parent.bottom, parent.top);
+
+    return QuadNodeData<CoordType>(firstChild + child, parent.depth + 1,
+        child & 2 ? halfY : parent.top, child & 2 ? parent.bottom : halfY,
+        child & 1 ? halfX : parent.left, child & 1 ? parent.right : halfX);
+}
+
+/* Returns the squared distance from the point to the nearest point of the box, or zero if the box contains it. */
+template<typename CoordType>
+inline double boxDistanceSquared(CoordType x, CoordType y, CoordType top, CoordType bottom, CoordType left, CoordType right)
+{
+    const double dx = x < left ? (double)left - x : x > right ? (double)x - right : 0.0,
+        dy = y < bottom ? (double)bottom - y : y > top ? (double)y - top : 0.0;
+
+    return dx * dx + dy * dy;
+}
+
+/* Clips the ray parameter range [tMin, tMax] to the part where the ray lies within [low, high] along one axis.
+ * Returns false if the range becomes empty. */
+inline bool clipRaySlab(double origin, double direction, double low, double high, double* tMin, double* tMax)
+{
+    if (direction == 0.0)
+        return origin >= low && origin <= high;
+
+    double t0 = (low - origin) / direction, t1 = (high - origin) / direction;
 
-    int quadNodeIndex, depth, top, bottom, left, right;
+    if (t0 > t1)
+        std::swap(t0, t1);
+    if (t0 > *tMin)
+        *tMin = t0;
+    if (t1 < *tMax)
+        *tMax = t1;
+
+    return *tMin <= *tMax;
+}
+
+/* Returns whether the ray hits the box within [0, maxT], storing the parameter at which it enters the box. A
+ * ray starting inside the box enters it at zero. */
+template<typename CoordType>
+inline bool rayBoxEntry(double originX, double originY, double directionX, double directionY, double maxT,
+    CoordType top, CoordType bottom, CoordType left, CoordType right, double* entry)
+{
+    double tMin = 0.0, tMax = maxT;
+
+    if (!clipRaySlab(originX, directionX, (double)left, (double)right, &tMin, &tMax) ||
+        !clipRaySlab(originY, directionY, (double)bottom, (double)top, &tMin, &tMax))
+        return false;
+
+    *entry = tMin;
+    return true;
+}
+
+/* A quadnode waiting to be visited by a nearest neighbour query. */
+template<typename CoordType>
+struct NearestNode
+{
+    double distanceSquared;
+    QuadNodeData<CoordType> data;
 };
 
+/* A collider found by a nearest neighbour query. */
+struct NearestCollider
+{
+    double distanceSquared;
+    int colliderIndex;
+};
+
+/* Stores a pair of overlapping colliders. */
+template<typename CoordType>
+struct ColliderPair
+{
+    ColliderPair();
+    ColliderPair(QuadTreeCollider<CoordType>* first, QuadTreeCollider<CoordType>* second);
+
+    QuadTreeCollider<CoordType>* first;
+    QuadTreeCollider<CoordType>* second;
+};
+
+/* Stores a collider hit by a ray and the ray parameter at which the ray enters it. */
+template<typename CoordType>
+struct RaycastHit
+{
+    RaycastHit();
+    RaycastHit(QuadTreeCollider<CoordType>* collider, double entry);
+
+    QuadTreeCollider<CoordType>* collider;
+    double entry;
+};
+
+/* Scratch space used by a query. Threads querying the same quadtree concurrently each need their own. */
+template<typename CoordType>
+struct QueryContext
+{
+    QueryContext();
+
+    /* Starts a new query over the given number of collider indices and returns its stamp. A collider has been
+     * seen by the current query if its entry in queryStamps equals the stamp, so nothing needs unmarking
+     * afterwards. */
+    unsigned int nextStamp(int numColliders);
+
+    /* The stamp of the last query to see each collider index. */
+    std::vector<unsigned int> queryStamps;
+
+    /* The stamp of the current query. */
+    unsigned int queryEpoch;
+
+    /* The collider indices gathered by cleanup when merging a subtree. */
+    FreeList<int> usedIndices;
+
+    /* The traversal stack used while descending the quadtree. */
+    FreeList<QuadNodeData<CoordType>> processingStack;
+
+#ifdef QUADTREE_COUNTERS
+    /* The work done by the queries using this context. */
+    QuadTreeCounters counters;
+#endif
+
+    /* The heap of quadnodes still to be visited by a nearest neighbour query, nearest first. */
+    std::vector<NearestNode<CoordType>> nodeQueue;
+
+    /* The heap of the best colliders found so far by a nearest neighbour query, farthest first. */
+    std::vector<NearestCollider> nearest;
+};
+
+template<typename CoordType = int>
+class QuadTreeCommandBuffer;
+
+/* A quadtree over coordinates of the given type. Integer and floating point coordinate types are supported. */
+template<typename CoordType = int>
 class QuadTree
 {
 public:
-    QuadTree(int top, int bottom, int left, int right, int maxDivisions, int maxEltsPerNode);
+    /* The category mask matching every collider. */
+    constexpr static std::uint32_t ALL_CATEGORIES = 0xffffffff;
 
-    /* Inserts the collider into the quadtree. */
-    int insert(QuadTreeCollider* collider);
+    QuadTree(CoordType top, CoordType bottom, CoordType left, CoordType right, int maxDivisions, int maxEltsPerNode);
 
-    /* Removes the collider from the quadtree. */
-    void remove(const QuadTreeCollider* collider, int colliderIndex);
+    /* Inserts the collider into the quadtree with the given category mask. */
+    int insert(QuadTreeCollider<CoordType>* collider, std::uint32_t categories = ALL_CATEGORIES);
+
+    /* Removes the collider from the quadtree by unlinking the element nodes it occupies, without descending
+     * the quadtree, so the collider may have been moved since it was inserted or last updated. */
+    void remove(const QuadTreeCollider<CoordType>* collider, int colliderIndex);
+
+    /* Moves an inserted collider from its old boundaries to its new boundaries. Only the leaves that were
+     * gained or lost are touched. The leaves held before are found from the collider's element nodes, so the
+     * old boundaries are only checked against the stored copy when assertions are enabled. */
+    void update(int colliderIndex, const QuadTreeCollider<CoordType>& oldBounds,
+        const QuadTreeCollider<CoordType>& newBounds);
+
+    /* Applies the commands recorded in the given buffers as a single batch, in buffer order and then in the order
+     * they were recorded. The commands on each collider are combined first, so a collider inserted and removed
+     * within the batch is never added, and only its final boundaries are used. Removals unlink their element
+     * nodes directly. Insertions and moves then descend the quadtree together, partitioned at every branch, so
+     * each leaf receives its new elements at once and is split at most once. The collider index given to each
+     * insertion is written to its command. The buffers are left for the caller to clear. */
+    void apply(QuadTreeCommandBuffer<CoordType>* buffers, int numBuffers);
+
+    /* Replaces the category mask of an inserted collider. Colliders added by build match every category until
+     * given a mask. The masks of the nodes holding the collider only lose categories at the next cleanup. */
+    void setCategories(int colliderIndex, std::uint32_t categories);
+
+    /* Clears the quadtree and bulk loads the given colliders by partitioning them top-down. Every node and
+     * element list is allocated once, in depth-first order. The collider at position i of the array is
+     * given the collider index i.
+     *
+     * With more than one thread, the top levels are split until there are several independent subtrees per
+     * thread, which are then built on worker threads into separate lists and stitched into the quadtree. The
+     * top levels are then allocated breadth-first. A thread count below one uses the hardware concurrency. */
+    void build(QuadTreeCollider<CoordType>* const* colliderArray, int numColliders, int numThreads = 1);
 
     /* Clears the quadtree of all inserted elements. */
     void clearElements();
@@ -54,42 +346,357 @@ public:
     void getAllLeaves(FreeList<int>* nodeIndices);
 
     /* Populates the list with all the quadnode leaf data. */
-    void getAllLeafDatas(FreeList<QuadNodeData>* quadNodeDatas);
+    void getAllLeafDatas(FreeList<QuadNodeData<CoordType>>* quadNodeDatas);
+
+    /* Copies every leaf's elements into contiguous arrays with inline boundaries. Until the quadtree is next
+     * modified, query and findAllPairs scan these arrays several boxes at a time instead of walking the
+     * element lists. */
+    void packLeaves();
 
-    /* Cleans up the quadtree. */
+    /* Rebuilds the quadnode and element node lists in depth-first order, removing the vacancies left by
+     * erasures, and releases their unused capacity along with that of the arrays indexed by their slots. Sibling
+     * nodes and the elements of each leaf end up next to each other. Collider indices are unchanged. The packed
+     * leaves are released, so packLeaves must be called again to use them. */
+    CompactionResult compact();
+
+    /* Sets the number of unique colliders below which cleanup merges a subtree back into a single leaf. It
+     * may not exceed maxEltsPerNode, so that merged leaves have room to grow before splitting again. The
+     * default of 1 only merges empty subtrees. */
+    void setMergeThreshold(int threshold);
+
+    /* Cleans up the quadtree in a single pass, merging every subtree that holds fewer unique colliders than
+     * the merge threshold. */
     void cleanup();
 
-    /* Populates the freelist with the pointers to the colliders inside the boundaries. */
-    void query(FreeList<QuadTreeCollider*>* output, int top, int bottom, int left, int right);
+    /* Continues the current cleanup pass, examining at most the given number of nodes. Returns true once the
+     * pass has covered the whole quadtree, after which the next call starts a new pass. */
+    bool cleanupIncremental(int nodeBudget);
+
+    /* Continues the current cleanup pass until the given time has elapsed. Returns true once the pass has
+     * covered the whole quadtree, after which the next call starts a new pass. */
+    bool cleanupIncremental(std::chrono::microseconds timeBudget);
+
+    /* Sets the depth of a flat grid of nodes from which insertions, removals and queries start their descent,
+     * skipping the levels above it. Each cell refers to the node at that depth or to the leaf above it covering
+     * the cell. A depth of zero removes the grid. With integer coordinates, every cell must be at least one
+     * unit wide and tall. */
+    void setGridDepth(int depth);
+
+    /* Writes the quadnodes, element nodes, collider boundaries, root boundaries and configuration to a binary
+     * file that QuadTreeSnapshot can map and query without rebuilding. Collider pointers are not saved, so the
+     * snapshot reports collider indices. Returns false if the file could not be written. */
+    bool saveSnapshot(const char* path) const;
+
+    /* Returns statistics about the shape of the quadtree and the occupancy of its lists. */
+    QuadTreeStats stats() const;
+
+#ifdef QUADTREE_COUNTERS
+    /* Resets the counters of the quadtree and of its own query context. */
+    void resetCounters();
+#endif
+
+    /* Populates the freelist with the pointers to the colliders inside the boundaries that share a category with
+     * the given mask. Subtrees holding none of its categories are skipped. */
+    void query(FreeList<QuadTreeCollider<CoordType>*>* output, CoordType top, CoordType bottom, CoordType left, CoordType right,
+        std::uint32_t categories = ALL_CATEGORIES);
+
+    /* As above, using the given context as scratch space. Safe to call from several threads while the quadtree
+     * is not modified. */
+    void query(QueryContext<CoordType>* context, FreeList<QuadTreeCollider<CoordType>*>* output, CoordType top,
+        CoordType bottom, CoordType left, CoordType right, std::uint32_t categories = ALL_CATEGORIES) const;
+
+    /* Populates the freelist with the pointers to the k colliders nearest to the point, nearest first, ignoring
+     * any farther away than the maximum distance. A collider containing the point is at distance zero. */
+    void queryNearest(FreeList<QuadTreeCollider<CoordType>*>* output, CoordType x, CoordType y, int k, CoordType maxDistance);
+
+    /* As above, using the given context as scratch space. Safe to call from several threads while the
+     * quadtree is not modified. */
+    void queryNearest(QueryContext<CoordType>* context, FreeList<QuadTreeCollider<CoordType>*>* output, CoordType x,
+        CoordType y, int k, CoordType maxDistance) const;
+
+    /* Calls the visitor with the pointer to every collider inside the boundaries during a single descent,
+     * without building any intermediate list. The visitor returns false to stop the query early, in which
+     * case false is returned. */
+    template<typename Visitor>
+    bool queryVisit(CoordType top, CoordType bottom, CoordType left, CoordType right, Visitor visitor);
+
+    /* As above, using the given context as scratch space. */
+    template<typename Visitor>
+    bool queryVisit(QueryContext<CoordType>* context, CoordType top, CoordType bottom, CoordType left, CoordType right,
+        Visitor visitor) const;
+
+    /* As above, only visiting colliders that share a category with the given mask. */
+    template<typename Visitor>
+    bool queryVisit(QueryContext<CoordType>* context, CoordType top, CoordType bottom, CoordType left, CoordType right,
+        std::uint32_t categories, Visitor visitor) const;
+
+    /* Finds the first collider hit by the ray from the origin along the direction, up to maxT times the length
+     * of the direction. Leaves are visited front to back and the search stops as soon as no nearer hit is
+     * possible. Returns false if nothing is hit. */
+    bool raycast(RaycastHit<CoordType>* hit, CoordType originX, CoordType originY, double directionX, double directionY,
+        double maxT);
+
+    /* As above, using the given context as scratch space. */
+    bool raycast(QueryContext<CoordType>* context, RaycastHit<CoordType>* hit, CoordType originX, CoordType originY,
+        double directionX, double directionY, double maxT) const;
 
-    FreeList<QuadTreeCollider*> colliders;
+    /* Populates the freelist with every collider hit by the segment, sorted by entry parameter. The parameter
+     * runs from zero at the start of the segment to one at its end. */
+    void segmentQuery(FreeList<RaycastHit<CoordType>>* output, CoordType startX, CoordType startY, CoordType endX,
+        CoordType endY);
+
+    /* As above, using the given context as scratch space. */
+    void segmentQuery(QueryContext<CoordType>* context, FreeList<RaycastHit<CoordType>>* output, CoordType startX,
+        CoordType startY, CoordType endX, CoordType endY) const;
+
+    /* Runs one query per rectangle, spread across one thread per given context. The results for rectangle i
+     * are appended to outputs[i]. The contexts belong to the caller, so batches run every frame reuse their
+     * scratch space instead of allocating it again. */
+    void queryBatch(QueryContext<CoordType>* contexts, int numContexts, const QuadTreeCollider<CoordType>* rects,
+        int numRects, FreeList<QuadTreeCollider<CoordType>*>* outputs) const;
+
+    /* Populates the freelist with every pair of overlapping colliders. Each leaf is visited once and
+     * each pair is reported once, even if both colliders share several leaves. */
+    void findAllPairs(FreeList<ColliderPair<CoordType>>* output);
+
+    /* Populates the freelist with every pair of overlapping colliders whose overlap lies partly inside both
+     * quadtrees, with the first collider from this quadtree and the second from the other. Both quadtrees are
+     * descended together, pruning pairs of nodes that do not overlap, and each pair is reported once. Nodes with
+     * identical boundaries, as in quadtrees sharing the same boundaries, are split together. */
+    void findAllPairs(const QuadTree<CoordType>& other, FreeList<ColliderPair<CoordType>>* output) const;
+
+    FreeList<QuadTreeCollider<CoordType>*> colliders;
     FreeList<QuadNode> quadNodes;
     FreeList<ElementNode> elementNodes;
 
 #ifndef NO_PRIVATE
     private:
 #endif
-    int topBound, bottomBound, leftBound, rightBound, maxDivisions, maxEltsPerNode;
+    CoordType topBound, bottomBound, leftBound, rightBound;
+
+    int maxDivisions, maxEltsPerNode;
 
     int rootNodeIndex;
     
-    std::vector<bool> queryTable;
+    /* Copies of the collider boundaries, indexed by collider index. These are kept by the quadtree so that
+     * overlap tests never dereference the collider pointers. */
+    std::vector<CoordType> colliderTops, colliderBottoms, colliderLefts, colliderRights;
+
+    /* The first of the element nodes occupied by each collider, indexed by collider index. */
+    std::vector<int> colliderFirstElements;
+
+    /* Indexed by element node index: the leaf holding the element, the previous element in the leaf's list and
+     * the next element node occupied by the same collider. */
+    std::vector<int> elementLeaves, elementPrevious, elementColliderNext;
+
+    /* The category mask of each collider, indexed by collider index. */
+    std::vector<std::uint32_t> colliderCategories;
+
+    /* The categories of the colliders below each quadnode, indexed by quadnode index. Removals leave them
+     * unchanged, so they may hold extra categories until the next cleanup. */
+    std::vector<std::uint32_t> nodeCategories;
+
+    /* Whether any collider has been given a mask other than ALL_CATEGORIES. Until then, cleanup does not need
+     * to recompute the node categories. */
+    bool categoriesUsed;
+
+    /* Contiguous copies of the leaf element lists made by packLeaves. A leaf's entries start at its offset,
+     * indexed by quadnode index, and run for its element count. */
+    std::vector<int> packedOffsets, packedColliders;
+    std::vector<CoordType> packedTops, packedBottoms, packedLefts, packedRights;
+
+    /* Whether the packed arrays reflect the current state of the quadtree. */
+    bool leavesPacked;
+
+    /* Subtrees holding fewer unique colliders than this are merged by cleanup. */
+    int mergeThreshold;
+
+    /* The branches still to be examined by the current cleanup pass. */
+    FreeList<int> cleanupStack;
+
+    /* The depth of the grid, or zero if there is none. */
+    int gridDepth;
+
+    /* The node covering each grid cell, indexed by row from the bottom and then by column from the left. */
+    std::vector<QuadNodeData<CoordType>> gridNodes;
+
+    /* The boundaries between grid columns and rows, starting and ending with those of the quadtree. */
+    std::vector<CoordType> gridColumnBounds, gridRowBounds;
+
+    /* The shifts mapping an integer offset from the left or bottom boundary to its column or row, or -1 if
+     * the quadtree's width or height is not a power of two. */
+    int gridColumnShift, gridRowShift;
+
+    /* Whether cleanup has merged nodes still referred to by the grid. */
+    bool gridStale;
+
+    /* Scratch space for the non-const query. */
+    QueryContext<CoordType> queryContext;
+
+#ifdef QUADTREE_COUNTERS
+    /* The work done outside of queries. */
+    QuadTreeCounters counters;
+#endif
 
     /* Populates the passed freelist with the quadNodeData objects corresponding to the quadnodes
-     * that contain some part of the passed boundaries. */
-    void getLeaves(FreeList<QuadNodeData>* output, int colliderTop, int colliderBottom, int colliderLeft, int colliderRight,
-        int quadNodeIndex, int depth, int top, int bottom, int left, int right);
+     * that contain some part of the passed boundaries. Every node visited gains the given categories. */
+    void getLeaves(FreeList<QuadNodeData<CoordType>>* output, CoordType colliderTop, CoordType colliderBottom,
+        CoordType colliderLeft, CoordType colliderRight, int quadNodeIndex, int depth, CoordType top, CoordType bottom,
+        CoordType left, CoordType right, std::uint32_t categories);
+
+    /* As above, using the given freelist as the traversal stack. */
+    void getLeaves(FreeList<QuadNodeData<CoordType>>* output, FreeList<QuadNodeData<CoordType>>* processingStack,
+        CoordType colliderTop, CoordType colliderBottom, CoordType colliderLeft, CoordType colliderRight, int quadNodeIndex,
+        int depth, CoordType top, CoordType bottom, CoordType left, CoordType right, std::uint32_t categories);
+
+    /* Recomputes the categories of every quadnode from the colliders below it. */
+    void recomputeCategories();
+
+    /* Returns the grid column or row containing the given coordinate, clamped to the grid. */
+    int gridCell(const std::vector<CoordType>& cellBounds, int shift, CoordType value) const;
+
+    /* Pushes the data of every distinct node of the grid that the boundaries overlap. */
+    void pushGridNodes(FreeList<QuadNodeData<CoordType>>* processingStack, CoordType colliderTop, CoordType colliderBottom,
+        CoordType colliderLeft, CoordType colliderRight) const;
+
+    /* Points every grid cell covered by the given node at it. The node must not be deeper than the grid. */
+    void setGridNode(const QuadNodeData<CoordType>& data);
+
+    /* Refills the grid from the quadtree. */
+    void rebuildGrid();
+
+    /* Calls the visitor with the index of every leaf the ray enters within [0, maxT], front to back. The visitor
+     * returns the largest parameter still of interest, and nodes entered beyond it are skipped. */
+    template<typename LeafVisitor>
+    void traverseRay(QueryContext<CoordType>* context, double originX, double originY, double directionX,
+        double directionY, double maxT, LeafVisitor visitLeaf) const;
+
+    /* Stores the boundaries of the given collider index. */
+    void setBounds(int colliderIndex, const QuadTreeCollider<CoordType>& bounds);
+
+    /* Records an element node just linked into the given leaf after the given previous element, and adds it to
+     * the element nodes of its collider. */
+    void linkElement(int elementIndex, int quadNodeIndex, int previous);
+
+    /* Unlinks the element node from its leaf and erases it. The collider's own list is left untouched. */
+    void unlinkElement(int elementIndex);
+
+    /* Removes the element node from the list of element nodes occupied by the collider. */
+    void unlinkColliderElement(int colliderIndex, int elementIndex);
+
+    /* Recomputes the links of every element node from the leaf lists. */
+    void relinkElements();
+
+    /* Links the element nodes, categories and grid cells of a subtree built in place by buildSubtree. */
+    void finishSubtree(const QuadNodeData<CoordType>& rootData);
 
     /* Inserts the given collider pointer into the given quadnode. */
-    void nodeInsert(int colliderIndex, const QuadNodeData& data);
+    void nodeInsert(int colliderIndex, const QuadNodeData<CoordType>& data);
+
+    /* Builds the subtree rooted at the given node into the given lists. The collider indices belonging to
+     * the node must occupy the whole partition buffer, which is used as scratch space. */
+    void buildSubtree(FreeList<QuadNode>* nodes, FreeList<ElementNode>* elements, std::vector<int>* partitions,
+        const QuadNodeData<CoordType>& rootData) const;
+
+    /* Splits the root into independent subtrees and builds them on the given number of threads. The collider
+     * indices belonging to the root must occupy the whole partition buffer. */
+    void buildParallel(std::vector<int>* partitions, int numThreads);
+
+    /* Examines branches from the cleanup stack until it empties, the node budget runs out or the deadline,
+     * if any, passes. Returns whether the stack emptied. */
+    bool runCleanup(int nodeBudget, const std::chrono::steady_clock::time_point* deadline);
+
+    /* Gathers the unique colliders below the given branch into the query context, stopping once the merge
+     * threshold is reached. Returns the number of nodes visited. */
+    int markSubtree(int quadNodeIndex);
+
+    /* Replaces the given branch by a leaf holding the colliders gathered by markSubtree. */
+    void mergeSubtree(int quadNodeIndex);
 
     /* Subdivides the given node. */
-    void subdivideNode(int quadNodeIndex, int depth, int top, int bottom, int left, int right);
+    void subdivideNode(int quadNodeIndex, int depth, CoordType top, CoordType bottom, CoordType left, CoordType right);
 };
 
-inline void pushBackNode(FreeList<QuadNodeData>* output, int quadNodeIndex, int depth, int top, int bottom, int left, int right)
+/* An insertion, removal or update of a collider recorded by a command buffer. */
+template<typename CoordType>
+struct QuadTreeCommand
 {
-    QuadNodeData& data = output->at(output->pushBack());
+    const static int INSERT = 0;
+    const static int REMOVE = 1;
+    const static int UPDATE = 2;
+
+    QuadTreeCommand();
+    QuadTreeCommand(int type, QuadTreeCollider<CoordType>* collider, int colliderIndex,
+        const QuadTreeCollider<CoordType>& bounds, std::uint32_t categories);
+
+    int type;
+    QuadTreeCollider<CoordType>* collider;
+
+    /* The index of the collider. An insertion is given its index when applied, and keeps NONE if it was
+     * cancelled by a later removal. */
+    int colliderIndex;
+
+    /* The boundaries of an insertion or update, copied when recorded. */
+    QuadTreeCollider<CoordType> bounds;
+
+    std::uint32_t categories;
+};
+
+/* Records insertions, removals and updates to be applied later by QuadTree::apply. Each thread records into a
+ * buffer of its own, so recording takes no locks. */
+template<typename CoordType>
+class QuadTreeCommandBuffer
+{
+public:
+    /* Records the insertion of the collider with its current boundaries. */
+    void insert(QuadTreeCollider<CoordType>* collider, std::uint32_t categories = QuadTree<CoordType>::ALL_CATEGORIES);
+
+    /* Records the removal of the collider. The index is ignored if the collider is inserted earlier in the
+     * same batch. */
+    void remove(QuadTreeCollider<CoordType>* collider, int colliderIndex);
+
+    /* Records the move of the collider to the given boundaries. The index is ignored if the collider is
+     * inserted earlier in the same batch. */
+    void update(QuadTreeCollider<CoordType>* collider, int colliderIndex, const QuadTreeCollider<CoordType>& newBounds);
+
+    /* Forgets every recorded command. */
+    void clear();
+
+    /* The recorded commands, in the order they were recorded. */
+    std::vector<QuadTreeCommand<CoordType>> commands;
+};
+
+/* Calls the function with every task index below numTasks, spread across the given number of threads, along with
+ * the index of the thread running the task. The calling thread works alongside the spawned ones as thread zero. */
+template<typename Function>
+inline void parallelFor(int numThreads, int numTasks, Function function)
+{
+    std::atomic<int> nextTask(0);
+
+    auto worker = [&](int thread)
+    {
+        int task;
+
+        while ((task = nextTask.fetch_add(1)) < numTasks)
+            function(task, thread);
+    };
+
+    std::vector<std::thread> threads;
+
+    for (int i = 1; i < std::min(numThreads, numTasks); i++)
+        threads.emplace_back(worker, i);
+
+    worker(0);
+
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+template<typename CoordType>
+inline void pushBackNode(FreeList<QuadNodeData<CoordType>>* output, int quadNodeIndex, int depth, CoordType top, CoordType bottom,
+    CoordType left, CoordType right)
+{
+    QuadNodeData<CoordType>& data = output->at(output->pushBack());
 
     data.quadNodeIndex = quadNodeIndex;
     data.depth = depth;
@@ -99,4 +706,6 @@ inline void pushBackNode(FreeList<QuadNodeData>* output, int quadNodeIndex, int
     data.right = right;
 }
 
+#include "quadtree.inl"
+
 #endif
\ No newline at end of file
@@ -0,0 +1,2560 @@
+#ifndef QUADTREE_INL_INCLUDED
+#define QUADTREE_INL_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <thread>
+
+template<typename CoordType>
+QuadNodeData<CoordType>::QuadNodeData()
+    : quadNodeIndex(0), depth(0), top(0), bottom(0), left(0), right(0)
+{
+}
+
+template<typename CoordType>
+QuadNodeData<CoordType>::QuadNodeData(int quadNodeIndex, int depth, CoordType top, CoordType bottom, CoordType left,
+    CoordType right)
+    : quadNodeIndex(quadNodeIndex), depth(depth), top(top), bottom(bottom), left(left), right(right)
+{
+}
+
+template<typename CoordType>
+ColliderPair<CoordType>::ColliderPair()
+    : first(nullptr), second(nullptr)
+{
+}
+
+template<typename CoordType>
+ColliderPair<CoordType>::ColliderPair(QuadTreeCollider<CoordType>* first, QuadTreeCollider<CoordType>* second)
+    : first(first), second(second)
+{
+}
+
+template<typename CoordType>
+RaycastHit<CoordType>::RaycastHit()
+    : collider(nullptr), entry(0.0)
+{
+}
+
+template<typename CoordType>
+RaycastHit<CoordType>::RaycastHit(QuadTreeCollider<CoordType>* collider, double entry)
+    : collider(collider), entry(entry)
+{
+}
+
+template<typename CoordType>
+QueryContext<CoordType>::QueryContext()
+    : queryEpoch(0)
+{
+}
+
+template<typename CoordType>
+unsigned int QueryContext<CoordType>::nextStamp(int numColliders)
+{
+    if ((int)this->queryStamps.size() < numColliders)
+        this->queryStamps.resize(numColliders, 0);
+
+    /* Once the epoch wraps around, clear the stamps so that none left over from earlier queries can match. */
+    if (++this->queryEpoch == 0)
+    {
+        std::fill(this->queryStamps.begin(), this->queryStamps.end(), 0);
+        this->queryEpoch = 1;
+    }
+
+    return this->queryEpoch;
+}
+
+template<typename CoordType>
+QuadTreeCommand<CoordType>::QuadTreeCommand()
+    : type(INSERT), collider(nullptr), colliderIndex(ElementNode::NONE), bounds(), categories(0)
+{
+}
+
+template<typename CoordType>
+QuadTreeCommand<CoordType>::QuadTreeCommand(int type, QuadTreeCollider<CoordType>* collider, int colliderIndex,
+    const QuadTreeCollider<CoordType>& bounds, std::uint32_t categories)
+    : type(type), collider(collider), colliderIndex(colliderIndex), bounds(bounds), categories(categories)
+{
+}
+
+template<typename CoordType>
+void QuadTreeCommandBuffer<CoordType>::insert(QuadTreeCollider<CoordType>* collider, std::uint32_t categories)
+{
+    this->commands.push_back(QuadTreeCommand<CoordType>(QuadTreeCommand<CoordType>::INSERT, collider, ElementNode::NONE,
+        *collider, categories));
+}
+
+template<typename CoordType>
+void QuadTreeCommandBuffer<CoordType>::remove(QuadTreeCollider<CoordType>* collider, int colliderIndex)
+{
+    this->commands.push_back(QuadTreeCommand<CoordType>(QuadTreeCommand<CoordType>::REMOVE, collider, colliderIndex,
+        QuadTreeCollider<CoordType>(), 0));
+}
+
+template<typename CoordType>
+void QuadTreeCommandBuffer<CoordType>::update(QuadTreeCollider<CoordType>* collider, int colliderIndex,
+    const QuadTreeCollider<CoordType>& newBounds)
+{
+    this->commands.push_back(QuadTreeCommand<CoordType>(QuadTreeCommand<CoordType>::UPDATE, collider, colliderIndex,
+        newBounds, 0));
+}
+
+template<typename CoordType>
+void QuadTreeCommandBuffer<CoordType>::clear()
+{
+    this->commands.clear();
+}
+
+template<typename CoordType>
+QuadTree<CoordType>::QuadTree(CoordType top, CoordType bottom, CoordType left, CoordType right, int maxDivisions,
+    int maxEltsPerNode)
+    : topBound(top), bottomBound(bottom), leftBound(left), rightBound(right),
+      maxDivisions(maxDivisions), maxEltsPerNode(maxEltsPerNode), categoriesUsed(false), leavesPacked(false),
+      mergeThreshold(1), gridDepth(0), gridColumnShift(-1), gridRowShift(-1), gridStale(false), queryContext()
+{
+    this->rootNodeIndex = this->quadNodes.insert();
+
+    QuadNode& rootNode = this->quadNodes.at(this->rootNodeIndex);
+
+    rootNode.firstChild = ElementNode::NONE;
+    rootNode.numElements = 0;
+
+    this->nodeCategories.resize(this->quadNodes.size(), 0);
+}
+
+template<typename CoordType>
+int QuadTree<CoordType>::insert(QuadTreeCollider<CoordType>* collider, std::uint32_t categories)
+{
+    FreeList<QuadNodeData<CoordType>> leavesForInsertion;
+
+    this->leavesPacked = false;
+    this->getLeaves(&leavesForInsertion, collider->top, collider->bottom, collider->left, collider->right, this->rootNodeIndex, 0,
+        this->topBound, this->bottomBound, this->leftBound, this->rightBound, categories);
+
+    const int numLeaves = leavesForInsertion.size();
+    const int colliderIndex = this->colliders.insert();
+
+    this->colliders.at(colliderIndex) = collider;
+    this->setBounds(colliderIndex, *collider);
+    this->colliderFirstElements[colliderIndex] = ElementNode::NONE;
+    this->colliderCategories[colliderIndex] = categories;
+    this->categoriesUsed |= categories != ALL_CATEGORIES;
+
+    for (int i = 0; i < numLeaves; i++)
+        this->nodeInsert(colliderIndex, leavesForInsertion.at(i));
+
+    return colliderIndex;
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::remove(const QuadTreeCollider<CoordType>* collider, int colliderIndex)
+{
+    assert(this->colliders.at(colliderIndex) == collider);
+    (void)collider;
+
+    this->leavesPacked = false;
+
+    /* Remove from all leaves that the collider occupies. */
+    for (int element = this->colliderFirstElements[colliderIndex]; element != ElementNode::NONE; )
+    {
+        const int nextElement = this->elementColliderNext[element];
+
+        this->unlinkElement(element);
+        element = nextElement;
+    }
+
+    this->colliderFirstElements[colliderIndex] = ElementNode::NONE;
+
+    /* Finally we remove the collider from the collider pointer freelist. */
+    this->colliders.erase(colliderIndex);
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::update(int colliderIndex, const QuadTreeCollider<CoordType>& oldBounds,
+    const QuadTreeCollider<CoordType>& newBounds)
+{
+    assert(oldBounds.top == this->colliderTops[colliderIndex] && oldBounds.bottom == this->colliderBottoms[colliderIndex] &&
+        oldBounds.left == this->colliderLefts[colliderIndex] && oldBounds.right == this->colliderRights[colliderIndex]);
+    (void)oldBounds;
+
+    FreeList<QuadNodeData<CoordType>> newLeaves;
+
+    /* Whether the collider already occupies each of the new leaves. */
+    FreeList<int> newLeavesHeld;
+
+    this->leavesPacked = false;
+    this->getLeaves(&newLeaves, newBounds.top, newBounds.bottom, newBounds.left, newBounds.right, this->rootNodeIndex, 0,
+        this->topBound, this->bottomBound, this->leftBound, this->rightBound, this->colliderCategories[colliderIndex]);
+
+    const int numNewLeaves = newLeaves.size();
+
+    for (int i = 0; i < numNewLeaves; i++)
+        newLeavesHeld.at(newLeavesHeld.pushBack()) = 0;
+
+    /* The leaves occupied before are those of the collider's element nodes. Remove from the ones that are no
+     * longer occupied, keeping the collider's list linked past them. */
+    for (int* link = &this->colliderFirstElements[colliderIndex]; *link != ElementNode::NONE; )
+    {
+        const int element = *link;
+        int i = 0;
+
+        while (i < numNewLeaves && newLeaves.at(i).quadNodeIndex != this->elementLeaves[element])
+            i++;
+
+        if (i < numNewLeaves)
+        {
+            newLeavesHeld.at(i) = 1;
+            link = &this->elementColliderNext[element];
+        }
+        else
+        {
+            *link = this->elementColliderNext[element];
+            this->unlinkElement(element);
+        }
+    }
+
+    /* Subdividing a leaf re-inserts its colliders, so the new boundaries must be stored first. */
+    this->setBounds(colliderIndex, newBounds);
+
+    /* Insert into the leaves that are newly occupied. Subdividing one of these leaves leaves the others
+     * untouched, so the list remains valid throughout. */
+    for (int i = 0; i < numNewLeaves; i++)
+        if (!newLeavesHeld.at(i))
+            this->nodeInsert(colliderIndex, newLeaves.at(i));
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::apply(QuadTreeCommandBuffer<CoordType>* buffers, int numBuffers)
+{
+    /* Each entry refers to a node and the range of the batch buffer holding the colliders descending into it. */
+    struct BatchEntry
+    {
+        QuadNodeData<CoordType> data;
+        int first, count;
+    };
+
+    std::vector<QuadTreeCommand<CoordType>*> commands;
+    std::vector<int> batch, moved;
+
+    for (int i = 0; i < numBuffers; i++)
+        for (QuadTreeCommand<CoordType>& command : buffers[i].commands)
+            commands.push_back(&command);
+
+    /* Bring the commands on each collider together, keeping their order. */
+    std::stable_sort(commands.begin(), commands.end(),
+        [](const QuadTreeCommand<CoordType>* first, const QuadTreeCommand<CoordType>* second)
+    {
+        return std::less<QuadTreeCollider<CoordType>*>()(first->collider, second->collider);
+    });
+
+    this->leavesPacked = false;
+
+    const auto insideBounds = [this](const QuadTreeCollider<CoordType>& bounds)
+    {
+        return bounds.bottom < this->topBound && bounds.top >= this->bottomBound && bounds.left < this->rightBound &&
+            bounds.right >= this->leftBound;
+    };
+
+    for (size_t first = 0, last; first < commands.size(); first = last)
+    {
+        QuadTreeCommand<CoordType>* inserted = nullptr;
+        const QuadTreeCommand<CoordType> *removed = nullptr, *updated = nullptr;
+        QuadTreeCollider<CoordType> insertedBounds;
+
+        for (last = first; last < commands.size() && commands[last]->collider == commands[first]->collider; last++)
+        {
+            QuadTreeCommand<CoordType>* command = commands[last];
+
+            if (command->type == QuadTreeCommand<CoordType>::INSERT)
+            {
+                assert(!inserted);
+
+                inserted = command;
+                insertedBounds = command->bounds;
+                command->colliderIndex = ElementNode::NONE;
+            }
+            else if (command->type == QuadTreeCommand<CoordType>::UPDATE)
+            {
+                if (inserted)
+                    insertedBounds = command->bounds;
+                else
+                    updated = command;
+            }
+            /* A removal cancels an insertion earlier in the batch. */
+            else if (inserted)
+                inserted = nullptr;
+            else
+                removed = command;
+        }
+
+        if (removed)
+            this->remove(removed->collider, removed->colliderIndex);
+        else if (updated)
+        {
+            this->setBounds(updated->colliderIndex, updated->bounds);
+            moved.push_back(updated->colliderIndex);
+
+            if (insideBounds(updated->bounds))
+                batch.push_back(updated->colliderIndex);
+        }
+
+        if (inserted)
+        {
+            const int colliderIndex = this->colliders.insert();
+
+            this->colliders.at(colliderIndex) = inserted->collider;
+            this->setBounds(colliderIndex, insertedBounds);
+            this->colliderFirstElements[colliderIndex] = ElementNode::NONE;
+            this->colliderCategories[colliderIndex] = inserted->categories;
+            this->categoriesUsed |= inserted->categories != ALL_CATEGORIES;
+            inserted->colliderIndex = colliderIndex;
+
+            if (insideBounds(insertedBounds))
+                batch.push_back(colliderIndex);
+        }
+    }
+
+    /* Partition the batch down to the leaves, as buildSubtree does, without changing the quadtree yet. */
+    std::vector<BatchEntry> toProcess, leaves;
+    std::vector<int> leafColliders;
+
+    if (batch.size())
+        toProcess.push_back({ QuadNodeData<CoordType>(this->rootNodeIndex, 0, this->topBound, this->bottomBound,
+            this->leftBound, this->rightBound), 0, (int)batch.size() });
+
+    while (toProcess.size())
+    {
+        const BatchEntry entry = toProcess.back();
+        const QuadNodeData<CoordType>& data = entry.data;
+        const QuadNode& node = this->quadNodes.at(data.quadNodeIndex);
+
+        toProcess.pop_back();
+        batch.resize(entry.first + entry.count);
+
+        for (int i = entry.first; i < entry.first + entry.count; i++)
+            this->nodeCategories[data.quadNodeIndex] |= this->colliderCategories[batch[i]];
+
+        if (node.numElements != QuadNode::BRANCH_NODE)
+        {
+            leaves.push_back({ data, (int)leafColliders.size(), entry.count });
+            leafColliders.insert(leafColliders.end(), batch.begin() + entry.first, batch.end());
+            continue;
+        }
+
+        const CoordType halfX = quadMidpoint(data.left, data.right), halfY = quadMidpoint(data.bottom, data.top);
+
+        for (int child = 3; child >= 0; child--)
+        {
+            const int childFirst = (int)batch.size();
+            int childLast = childFirst;
+
+            /* Every collider is written and only those in the child are kept, as a branch on the test would be
+             * mispredicted about as often as not. */
+            batch.resize(childFirst + entry.count);
+
+            for (int i = entry.first; i < entry.first + entry.count; i++)
+            {
+                const int colliderIndex = batch[i];
+                const bool inColumn = child & 1 ? this->colliderRights[colliderIndex] >= halfX :
+                    this->colliderLefts[colliderIndex] < halfX;
+                const bool inRow = child & 2 ? this->colliderBottoms[colliderIndex] < halfY :
+                    this->colliderTops[colliderIndex] >= halfY;
+
+                batch[childLast] = colliderIndex;
+                childLast += inColumn & inRow;
+            }
+
+            batch.resize(childLast);
+
+            if (childLast > childFirst)
+                toProcess.push_back({ childNodeData(data, node.firstChild, child), childFirst, childLast - childFirst });
+        }
+    }
+
+    /* Moved colliders keep the elements in leaves they still reach and lose the others. Each leaf's own list is
+     * walked once, matching its elements to the positions of the moved colliders that reach it, so a collider
+     * spanning many leaves is never walked once per leaf. A kept element is flagged by negating its leaf until
+     * the colliders' lists are walked. */
+    std::vector<unsigned int>& queryStamps = this->queryContext.queryStamps;
+    const unsigned int stamp = this->queryContext.nextStamp(this->colliders.size());
+    std::vector<int> positions(moved.empty() ? 0 : this->colliders.size(), ElementNode::NONE);
+
+    for (const int colliderIndex : moved)
+        queryStamps[colliderIndex] = stamp;
+
+    for (const BatchEntry& leaf : leaves)
+    {
+        const int first = leaf.first, last = leaf.first + leaf.count;
+        bool reachedByMoved = false;
+
+        for (int i = first; i < last; i++)
+        {
+            if (queryStamps[leafColliders[i]] == stamp)
+            {
+                positions[leafColliders[i]] = i;
+                reachedByMoved = true;
+            }
+        }
+
+        if (!reachedByMoved)
+            continue;
+
+        /* Positions left over from other leaves, or never set, fall outside this leaf's range. */
+        for (int element = this->quadNodes.at(leaf.data.quadNodeIndex).firstChild; element != ElementNode::NONE;
+            element = this->elementNodes.at(element).next)
+        {
+            const int colliderIndex = this->elementNodes.at(element).colliderIndex;
+
+            if (queryStamps[colliderIndex] == stamp && positions[colliderIndex] >= first &&
+                positions[colliderIndex] < last)
+            {
+                leafColliders[positions[colliderIndex]] = ElementNode::NONE;
+                this->elementLeaves[element] = -1 - leaf.data.quadNodeIndex;
+            }
+        }
+    }
+
+    for (const int colliderIndex : moved)
+    {
+        for (int element = this->colliderFirstElements[colliderIndex]; element != ElementNode::NONE; )
+        {
+            const int nextElement = this->elementColliderNext[element];
+
+            if (this->elementLeaves[element] < 0)
+                this->elementLeaves[element] = -1 - this->elementLeaves[element];
+            else
+            {
+                this->unlinkColliderElement(colliderIndex, element);
+                this->unlinkElement(element);
+            }
+
+            element = nextElement;
+        }
+    }
+
+    /* Add each leaf's new elements at once, rebuilding the leaf as a subtree if they overfill it. */
+    std::vector<int> partitions;
+
+    for (const BatchEntry& leaf : leaves)
+    {
+        const QuadNodeData<CoordType>& data = leaf.data;
+        int numNew = 0;
+
+        for (int i = leaf.first; i < leaf.first + leaf.count; i++)
+            numNew += leafColliders[i] != ElementNode::NONE;
+
+        if (numNew == 0)
+            continue;
+
+        QuadNode& node = this->quadNodes.at(data.quadNodeIndex);
+
+        if (node.numElements + numNew <= this->maxEltsPerNode || data.depth >= this->maxDivisions)
+        {
+            for (int i = leaf.first; i < leaf.first + leaf.count; i++)
+            {
+                if (leafColliders[i] == ElementNode::NONE)
+                    continue;
+
+                const int newElementIndex = this->elementNodes.insert();
+
+                this->elementNodes.at(newElementIndex).colliderIndex = leafColliders[i];
+                this->elementNodes.at(newElementIndex).next = node.firstChild;
+
+                node.firstChild = newElementIndex;
+                node.numElements++;
+                this->linkElement(newElementIndex, data.quadNodeIndex, ElementNode::NONE);
+            }
+
+            continue;
+        }
+
+        QUADTREE_COUNT(this->counters.subdivisions, 1);
+
+        partitions.clear();
+
+        for (int element = node.firstChild; element != ElementNode::NONE; )
+        {
+            const int colliderIndex = this->elementNodes.at(element).colliderIndex;
+            const int nextElement = this->elementNodes.at(element).next;
+
+            partitions.push_back(colliderIndex);
+            this->unlinkColliderElement(colliderIndex, element);
+            this->elementNodes.erase(element);
+
+            element = nextElement;
+        }
+
+        for (int i = leaf.first; i < leaf.first + leaf.count; i++)
+            if (leafColliders[i] != ElementNode::NONE)
+                partitions.push_back(leafColliders[i]);
+
+        this->buildSubtree(&this->quadNodes, &this->elementNodes, &partitions, data);
+        this->finishSubtree(data);
+    }
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::setCategories(int colliderIndex, std::uint32_t categories)
+{
+    FreeList<QuadNodeData<CoordType>> leaves;
+
+    this->colliderCategories[colliderIndex] = categories;
+    this->categoriesUsed |= categories != ALL_CATEGORIES;
+
+    /* Descending to the collider's leaves adds its categories to every node on the way. */
+    this->getLeaves(&leaves, this->colliderTops[colliderIndex], this->colliderBottoms[colliderIndex],
+        this->colliderLefts[colliderIndex], this->colliderRights[colliderIndex], this->rootNodeIndex, 0, this->topBound,
+        this->bottomBound, this->leftBound, this->rightBound, categories);
+}
+
+template<typename CoordType>
+bool QuadTree<CoordType>::saveSnapshot(const char* path) const
+{
+    static_assert(sizeof(QuadNode) == 2 * sizeof(std::int32_t) && sizeof(ElementNode) == 2 * sizeof(std::int32_t),
+        "Snapshots store quadnodes and element nodes as pairs of 32 bit integers.");
+
+    const auto align = [](std::uint64_t offset)
+    {
+        return (offset + SnapshotHeader::ALIGNMENT - 1) / SnapshotHeader::ALIGNMENT * SnapshotHeader::ALIGNMENT;
+    };
+
+    SnapshotHeader header = SnapshotHeader();
+
+    header.magic = SnapshotHeader::MAGIC;
+    header.version = SnapshotHeader::VERSION;
+    header.byteOrder = SnapshotHeader::BYTE_ORDER_MARK;
+    header.coordinateType = snapshotCoordinateType<CoordType>();
+    header.maxDivisions = this->maxDivisions;
+    header.maxEltsPerNode = this->maxEltsPerNode;
+    header.rootNodeIndex = this->rootNodeIndex;
+    header.numQuadNodes = this->quadNodes.size();
+    header.numElementNodes = this->elementNodes.size();
+    header.numColliders = this->colliders.size();
+    header.quadNodesOffset = align(sizeof(SnapshotHeader));
+    header.elementNodesOffset = align(header.quadNodesOffset + (std::uint64_t)header.numQuadNodes * sizeof(QuadNode));
+    header.boundsOffset = align(header.elementNodesOffset + (std::uint64_t)header.numElementNodes * sizeof(ElementNode));
+    header.fileSize = header.boundsOffset + (4 + 4 * (std::uint64_t)header.numColliders) * sizeof(CoordType);
+
+    std::FILE* file = std::fopen(path, "wb");
+
+    if (!file)
+        return false;
+
+    std::uint64_t written = 0;
+    bool succeeded = true;
+
+    /* Writes the bytes at the given offset, padding with zeroes from the end of the previous write. */
+    const auto write = [&](std::uint64_t offset, const void* data, std::uint64_t numBytes)
+    {
+        static const char padding[SnapshotHeader::ALIGNMENT] = {};
+
+        assert(offset >= written && offset - written <= SnapshotHeader::ALIGNMENT);
+
+        succeeded = succeeded && std::fwrite(padding, 1, (std::size_t)(offset - written), file) == offset - written &&
+            (numBytes == 0 || std::fwrite(data, 1, (std::size_t)numBytes, file) == numBytes);
+        written = offset + numBytes;
+    };
+
+    assert((int)this->colliderTops.size() >= header.numColliders);
+
+    const CoordType rootBounds[4] = {this->topBound, this->bottomBound, this->leftBound, this->rightBound};
+    const std::uint64_t boundsSize = (std::uint64_t)header.numColliders * sizeof(CoordType);
+
+    write(0, &header, sizeof(SnapshotHeader));
+    write(header.quadNodesOffset, header.numQuadNodes ? &this->quadNodes.at(0) : nullptr,
+        (std::uint64_t)header.numQuadNodes * sizeof(QuadNode));
+    write(header.elementNodesOffset, header.numElementNodes ? &this->elementNodes.at(0) : nullptr,
+        (std::uint64_t)header.numElementNodes * sizeof(ElementNode));
+    write(header.boundsOffset, rootBounds, sizeof(rootBounds));
+    write(written, this->colliderTops.data(), boundsSize);
+    write(written, this->colliderBottoms.data(), boundsSize);
+    write(written, this->colliderLefts.data(), boundsSize);
+    write(written, this->colliderRights.data(), boundsSize);
+
+    return std::fclose(file) == 0 && succeeded && written == header.fileSize;
+}
+
+template<typename CoordType>
+QuadTreeStats QuadTree<CoordType>::stats() const
+{
+    QuadTreeStats result;
+    FreeList<QuadNodeData<CoordType>> toProcess;
+    long long numElements = 0;
+
+    pushBackNode(&toProcess, this->rootNodeIndex, 0, this->topBound, this->bottomBound, this->leftBound, this->rightBound);
+
+    while (toProcess.size())
+    {
+        const QuadNodeData<CoordType> data = toProcess.at(toProcess.size() - 1);
+        const QuadNode& node = this->quadNodes.at(data.quadNodeIndex);
+
+        toProcess.popBack();
+
+        if (data.depth > result.maxDepth)
+            result.maxDepth = data.depth;
+
+        if (node.numElements == QuadNode::BRANCH_NODE)
+        {
+            result.numBranches++;
+
+            for (int i = 0; i < 4; i++)
+                toProcess.at(toProcess.pushBack()) = childNodeData(data, node.firstChild, i);
+
+            continue;
+        }
+
+        result.numLeaves++;
+        numElements += node.numElements;
+
+        if (node.numElements > this->maxEltsPerNode)
+            result.numOverfullLeaves++;
+
+        if ((int)result.leavesPerDepth.size() <= data.depth)
+            result.leavesPerDepth.resize(data.depth + 1, 0);
+        if ((int)result.leavesPerElementCount.size() <= node.numElements)
+            result.leavesPerElementCount.resize(node.numElements + 1, 0);
+
+        result.leavesPerDepth[data.depth]++;
+        result.leavesPerElementCount[node.numElements]++;
+    }
+
+    if (this->colliders.getNumElements())
+        result.averageLeavesPerCollider = (double)numElements / this->colliders.getNumElements();
+
+    result.colliders = FreeListUsage(this->colliders.getNumElements(), this->colliders.size(), this->colliders.getCapacity());
+    result.quadNodes = FreeListUsage(this->quadNodes.getNumElements(), this->quadNodes.size(), this->quadNodes.getCapacity());
+    result.elementNodes = FreeListUsage(this->elementNodes.getNumElements(), this->elementNodes.size(),
+        this->elementNodes.getCapacity());
+
+#ifdef QUADTREE_COUNTERS
+    result.counters = this->counters;
+    result.counters.add(this->queryContext.counters);
+#endif
+
+    return result;
+}
+
+#ifdef QUADTREE_COUNTERS
+template<typename CoordType>
+void QuadTree<CoordType>::resetCounters()
+{
+    this->counters = QuadTreeCounters();
+    this->queryContext.counters = QuadTreeCounters();
+}
+#endif
+
+template<typename CoordType>
+void QuadTree<CoordType>::query(FreeList<QuadTreeCollider<CoordType>*>* output, CoordType top, CoordType bottom,
+    CoordType left, CoordType right, std::uint32_t categories)
+{
+    this->query(&this->queryContext, output, top, bottom, left, right, categories);
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::query(QueryContext<CoordType>* context, FreeList<QuadTreeCollider<CoordType>*>* output,
+    CoordType top, CoordType bottom, CoordType left, CoordType right, std::uint32_t categories) const
+{
+    this->queryVisit(context, top, bottom, left, right, categories, [output](QuadTreeCollider<CoordType>* collider)
+    {
+        output->at(output->pushBack()) = collider;
+        return true;
+    });
+}
+
+template<typename CoordType>
+template<typename Visitor>
+bool QuadTree<CoordType>::queryVisit(CoordType top, CoordType bottom, CoordType left, CoordType right, Visitor visitor)
+{
+    return this->queryVisit(&this->queryContext, top, bottom, left, right, visitor);
+}
+
+template<typename CoordType>
+template<typename Visitor>
+bool QuadTree<CoordType>::queryVisit(QueryContext<CoordType>* context, CoordType top, CoordType bottom, CoordType left,
+    CoordType right, Visitor visitor) const
+{
+    return this->queryVisit(context, top, bottom, left, right, ALL_CATEGORIES, visitor);
+}
+
+template<typename CoordType>
+template<typename Visitor>
+bool QuadTree<CoordType>::queryVisit(QueryContext<CoordType>* context, CoordType top, CoordType bottom, CoordType left,
+    CoordType right, std::uint32_t categories, Visitor visitor) const
+{
+    /* Return early if the boundaries do not overlap the quadtree. */
+    if (this->topBound <= bottom || this->bottomBound > top || this->rightBound <= left || this->leftBound > right)
+        return true;
+
+    FreeList<QuadNodeData<CoordType>>& processingStack = context->processingStack;
+    std::vector<unsigned int>& queryStamps = context->queryStamps;
+    const unsigned int stamp = context->nextStamp(this->colliders.size());
+
+    processingStack.clear();
+
+    if (this->gridDepth > 0)
+        this->pushGridNodes(&processingStack, top, bottom, left, right);
+    else
+        pushBackNode(&processingStack, this->rootNodeIndex, 0, this->topBound, this->bottomBound, this->leftBound, this->rightBound);
+
+    while (processingStack.size() > 0)
+    {
+        const QuadNodeData<CoordType> data = processingStack.at(processingStack.size() - 1);
+        const QuadNode& node = this->quadNodes.at(data.quadNodeIndex);
+
+        processingStack.popBack();
+        QUADTREE_COUNT(context->counters.nodesVisited, 1);
+
+        /* Skip subtrees holding none of the categories. */
+        if (!(this->nodeCategories[data.quadNodeIndex] & categories))
+            continue;
+
+        if (node.numElements == QuadNode::BRANCH_NODE)
+        {
+            const CoordType halfX = quadMidpoint(data.left, data.right), halfY = quadMidpoint(data.bottom, data.top);
+
+            if (left < halfX)
+            {
+                /* Top left. */
+                if (top >= halfY)
+                    pushBackNode(&processingStack, node.firstChild, data.depth + 1, data.top, halfY, data.left, halfX);
+                /* Bottom left. */
+                if (bottom < halfY)
+                    pushBackNode(&processingStack, node.firstChild + 2, data.depth + 1, halfY, data.bottom, data.left, halfX);
+            }
+            if (right >= halfX)
+            {
+                /* Top right. */
+                if (top >= halfY)
+                    pushBackNode(&processingStack, node.firstChild + 1, data.depth + 1, data.top, halfY, halfX, data.right);
+                /* Bottom right. */
+                if (bottom < halfY)
+                    pushBackNode(&processingStack, node.firstChild + 3, data.depth + 1, halfY, data.bottom, halfX, data.right);
+            }
+
+            continue;
+        }
+
+        /* Scan the packed copy of the leaf several boxes at a time if it is up to date. */
+        if (this->leavesPacked)
+        {
+            const int first = this->packedOffsets[data.quadNodeIndex], last = first + node.numElements;
+
+            QUADTREE_COUNT(context->counters.elementsTested, last - first);
+
+            const bool finished = forEachOverlap(this->packedTops.data(), this->packedBottoms.data(),
+                this->packedLefts.data(), this->packedRights.data(), first, last, top, bottom, left, right, [&](int packedIndex)
+            {
+                const int overlappingIndex = this->packedColliders[packedIndex];
+
+                if (queryStamps[overlappingIndex] == stamp)
+                {
+                    QUADTREE_COUNT(context->counters.duplicatesRejected, 1);
+                    return true;
+                }
+
+                queryStamps[overlappingIndex] = stamp;
+
+                if (!(this->colliderCategories[overlappingIndex] & categories))
+                    return true;
+
+                return (bool)visitor(this->colliders.at(overlappingIndex));
+            });
+
+            if (!finished)
+                return false;
+
+            continue;
+        }
+
+        for (int element = node.firstChild; element != ElementNode::NONE; element = this->elementNodes.at(element).next)
+        {
+            const int colliderIndex = this->elementNodes.at(element).colliderIndex;
+
+            if (queryStamps[colliderIndex] == stamp)
+            {
+                QUADTREE_COUNT(context->counters.duplicatesRejected, 1);
+                continue;
+            }
+
+            QUADTREE_COUNT(context->counters.elementsTested, 1);
+
+            /* Visit the collider if it intersects the given boundaries and shares a category. */
+            if (this->colliderLefts[colliderIndex] <= right &&
+                this->colliderRights[colliderIndex] >= left &&
+                this->colliderTops[colliderIndex] >= bottom &&
+                this->colliderBottoms[colliderIndex] <= top)
+            {
+                queryStamps[colliderIndex] = stamp;
+
+                if (!(this->colliderCategories[colliderIndex] & categories))
+                    continue;
+
+                if (!visitor(this->colliders.at(colliderIndex)))
+                    return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::queryNearest(FreeList<QuadTreeCollider<CoordType>*>* output, CoordType x, CoordType y, int k,
+    CoordType maxDistance)
+{
+    this->queryNearest(&this->queryContext, output, x, y, k, maxDistance);
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::queryNearest(QueryContext<CoordType>* context, FreeList<QuadTreeCollider<CoordType>*>* output,
+    CoordType x, CoordType y, int k, CoordType maxDistance) const
+{
+    if (k <= 0)
+        return;
+
+    std::vector<NearestNode<CoordType>>& nodeQueue = context->nodeQueue;
+    std::vector<NearestCollider>& nearest = context->nearest;
+    std::vector<unsigned int>& queryStamps = context->queryStamps;
+    const unsigned int stamp = context->nextStamp(this->colliders.size());
+
+    const auto nodeIsFarther = [](const NearestNode<CoordType>& a, const NearestNode<CoordType>& b)
+    {
+        return a.distanceSquared > b.distanceSquared;
+    };
+
+    const auto colliderIsNearer = [](const NearestCollider& a, const NearestCollider& b)
+    {
+        return a.distanceSquared < b.distanceSquared;
+    };
+
+    nodeQueue.clear();
+    nearest.clear();
+
+    /* Nothing farther than this can be accepted. It shrinks to the distance of the k-th best collider once
+     * k have been found. */
+    double cutoff = (double)maxDistance * maxDistance;
+
+    /* Colliders may reach past the quadtree, and their parts outside it are held by the leaves along its edge.
+     * The sides of a node lying on the quadtree's boundaries are therefore taken to extend to infinity, so that
+     * the distance of a node never exceeds that of a collider it holds. */
+    const auto nodeDistanceSquared = [this, x, y](const QuadNodeData<CoordType>& data)
+    {
+        const double infinity = std::numeric_limits<double>::infinity();
+
+        return boxDistanceSquared<double>(x, y, data.top == this->topBound ? infinity : (double)data.top,
+            data.bottom == this->bottomBound ? -infinity : (double)data.bottom,
+            data.left == this->leftBound ? -infinity : (double)data.left,
+            data.right == this->rightBound ? infinity : (double)data.right);
+    };
+
+    const QuadNodeData<CoordType> rootData(this->rootNodeIndex, 0, this->topBound, this->bottomBound, this->leftBound,
+        this->rightBound);
+
+    nodeQueue.push_back({nodeDistanceSquared(rootData), rootData});
+
+    /* Visit the nodes nearest first. A collider lies in a leaf at least as near as the collider itself, so once
+     * the nearest remaining node is beyond the cutoff, no collider left unseen can beat it. */
+    while (!nodeQueue.empty() && nodeQueue.front().distanceSquared <= cutoff)
+    {
+        std::pop_heap(nodeQueue.begin(), nodeQueue.end(), nodeIsFarther);
+
+        const QuadNodeData<CoordType> data = nodeQueue.back().data;
+        const QuadNode& node = this->quadNodes.at(data.quadNodeIndex);
+
+        nodeQueue.pop_back();
+        QUADTREE_COUNT(context->counters.nodesVisited, 1);
+
+        if (node.numElements == QuadNode::BRANCH_NODE)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                const QuadNodeData<CoordType> child = childNodeData(data, node.firstChild, i);
+                const double distanceSquared = nodeDistanceSquared(child);
+
+                if (distanceSquared <= cutoff)
+                {
+                    nodeQueue.push_back({distanceSquared, child});
+                    std::push_heap(nodeQueue.begin(), nodeQueue.end(), nodeIsFarther);
+                }
+            }
+
+            continue;
+        }
+
+        for (int element = node.firstChild; element != ElementNode::NONE; element = this->elementNodes.at(element).next)
+        {
+            const int colliderIndex = this->elementNodes.at(element).colliderIndex;
+
+            /* A collider has the same distance from every leaf it is in, so it only needs testing once. */
+            if (queryStamps[colliderIndex] == stamp)
+            {
+                QUADTREE_COUNT(context->counters.duplicatesRejected, 1);
+                continue;
+            }
+
+            queryStamps[colliderIndex] = stamp;
+            QUADTREE_COUNT(context->counters.elementsTested, 1);
+
+            const double distanceSquared = boxDistanceSquared(x, y, this->colliderTops[colliderIndex],
+                this->colliderBottoms[colliderIndex], this->colliderLefts[colliderIndex], this->colliderRights[colliderIndex]);
+
+            if (distanceSquared > cutoff)
+                continue;
+
+            nearest.push_back({distanceSquared, colliderIndex});
+            std::push_heap(nearest.begin(), nearest.end(), colliderIsNearer);
+
+            if ((int)nearest.size() > k)
+            {
+                std::pop_heap(nearest.begin(), nearest.end(), colliderIsNearer);
+                nearest.pop_back();
+            }
+
+            if ((int)nearest.size() == k)
+                cutoff = nearest.front().distanceSquared;
+        }
+    }
+
+    std::sort_heap(nearest.begin(), nearest.end(), colliderIsNearer);
+
+    for (const NearestCollider& found : nearest)
+        output->at(output->pushBack()) = this->colliders.at(found.colliderIndex);
+}
+
+template<typename CoordType>
+bool QuadTree<CoordType>::raycast(RaycastHit<CoordType>* hit, CoordType originX, CoordType originY, double directionX,
+    double directionY, double maxT)
+{
+    return this->raycast(&this->queryContext, hit, originX, originY, directionX, directionY, maxT);
+}
+
+template<typename CoordType>
+bool QuadTree<CoordType>::raycast(QueryContext<CoordType>* context, RaycastHit<CoordType>* hit, CoordType originX,
+    CoordType originY, double directionX, double directionY, double maxT) const
+{
+    int bestIndex = ElementNode::NONE;
+    double bestEntry = maxT;
+
+    this->traverseRay(context, originX, originY, directionX, directionY, maxT, [&](int leafIndex)
+    {
+        /* A collider may be tested once per leaf it is in, which is cheaper than tracking which were seen. */
+        for (int element = this->quadNodes.at(leafIndex).firstChild; element != ElementNode::NONE;
+            element = this->elementNodes.at(element).next)
+        {
+            const int colliderIndex = this->elementNodes.at(element).colliderIndex;
+            double entry;
+
+            QUADTREE_COUNT(context->counters.elementsTested, 1);
+
+            if (rayBoxEntry(originX, originY, directionX, directionY, bestEntry, this->colliderTops[colliderIndex],
+                this->colliderBottoms[colliderIndex], this->colliderLefts[colliderIndex], this->colliderRights[colliderIndex], &entry) &&
+                (bestIndex == ElementNode::NONE || entry < bestEntry))
+            {
+                bestIndex = colliderIndex;
+                bestEntry = entry;
+            }
+        }
+
+        return bestEntry;
+    });
+
+    if (bestIndex == ElementNode::NONE)
+        return false;
+
+    *hit = RaycastHit<CoordType>(this->colliders.at(bestIndex), bestEntry);
+    return true;
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::segmentQuery(FreeList<RaycastHit<CoordType>>* output, CoordType startX, CoordType startY,
+    CoordType endX, CoordType endY)
+{
+    this->segmentQuery(&this->queryContext, output, startX, startY, endX, endY);
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::segmentQuery(QueryContext<CoordType>* context, FreeList<RaycastHit<CoordType>>* output,
+    CoordType startX, CoordType startY, CoordType endX, CoordType endY) const
+{
+    std::vector<unsigned int>& queryStamps = context->queryStamps;
+    const unsigned int stamp = context->nextStamp(this->colliders.size());
+
+    const double directionX = (double)endX - startX, directionY = (double)endY - startY;
+    const int firstHit = output->size();
+
+    this->traverseRay(context, startX, startY, directionX, directionY, 1.0, [&](int leafIndex)
+    {
+        for (int element = this->quadNodes.at(leafIndex).firstChild; element != ElementNode::NONE;
+            element = this->elementNodes.at(element).next)
+        {
+            const int colliderIndex = this->elementNodes.at(element).colliderIndex;
+            double entry;
+
+            if (queryStamps[colliderIndex] == stamp)
+            {
+                QUADTREE_COUNT(context->counters.duplicatesRejected, 1);
+                continue;
+            }
+
+            queryStamps[colliderIndex] = stamp;
+            QUADTREE_COUNT(context->counters.elementsTested, 1);
+
+            if (rayBoxEntry(startX, startY, directionX, directionY, 1.0, this->colliderTops[colliderIndex],
+                this->colliderBottoms[colliderIndex], this->colliderLefts[colliderIndex], this->colliderRights[colliderIndex], &entry))
+                output->at(output->pushBack()) = RaycastHit<CoordType>(this->colliders.at(colliderIndex), entry);
+        }
+
+        return 1.0;
+    });
+
+    /* Leaves arrive roughly in order already, but a collider spanning several leaves may be found late. */
+    std::stable_sort(output->unsafePtr(firstHit), output->unsafePtr(output->size()),
+        [](const RaycastHit<CoordType>& a, const RaycastHit<CoordType>& b)
+    {
+        return a.entry < b.entry;
+    });
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::queryBatch(QueryContext<CoordType>* contexts, int numContexts,
+    const QuadTreeCollider<CoordType>* rects, int numRects, FreeList<QuadTreeCollider<CoordType>*>* outputs) const
+{
+    assert(numContexts > 0);
+
+    /* Rectangles are handed out in small chunks so that uneven query costs balance across threads. Each thread
+     * queries with the context matching its index. */
+    const int chunkSize = 16;
+
+    parallelFor(numContexts, (numRects + chunkSize - 1) / chunkSize, [&](int chunk, int thread)
+    {
+        const int first = chunk * chunkSize, last = std::min(first + chunkSize, numRects);
+
+        for (int i = first; i < last; i++)
+            this->query(contexts + thread, outputs + i, rects[i].top, rects[i].bottom, rects[i].left, rects[i].right);
+    });
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::findAllPairs(FreeList<ColliderPair<CoordType>>* output)
+{
+    FreeList<QuadNodeData<CoordType>> leaves;
+
+    /* Scratch arrays that unpacked leaves are gathered into so that both layouts share the pair test. */
+    std::vector<int> leafColliders;
+    std::vector<CoordType> leafTops, leafBottoms, leafLefts, leafRights;
+
+    this->getAllLeafDatas(&leaves);
+
+    const int numLeaves = leaves.size();
+
+    for (int i = 0; i < numLeaves; i++)
+    {
+        const QuadNodeData<CoordType>& leaf = leaves.at(i);
+        const int numColliders = this->quadNodes.at(leaf.quadNodeIndex).numElements;
+
+        const int* colliderIndices;
+        const CoordType *tops, *bottoms, *lefts, *rights;
+
+        if (this->leavesPacked)
+        {
+            const int offset = this->packedOffsets[leaf.quadNodeIndex];
+
+            colliderIndices = this->packedColliders.data() + offset;
+            tops = this->packedTops.data() + offset;
+            bottoms = this->packedBottoms.data() + offset;
+            lefts = this->packedLefts.data() + offset;
+            rights = this->packedRights.data() + offset;
+        }
+        else
+        {
+            int elementIndex = this->quadNodes.at(leaf.quadNodeIndex).firstChild;
+
+            leafColliders.clear();
+            leafTops.clear();
+            leafBottoms.clear();
+            leafLefts.clear();
+            leafRights.clear();
+
+            while (elementIndex != ElementNode::NONE)
+            {
+                const int colliderIndex = this->elementNodes.at(elementIndex).colliderIndex;
+
+                leafColliders.push_back(colliderIndex);
+                leafTops.push_back(this->colliderTops[colliderIndex]);
+                leafBottoms.push_back(this->colliderBottoms[colliderIndex]);
+                leafLefts.push_back(this->colliderLefts[colliderIndex]);
+                leafRights.push_back(this->colliderRights[colliderIndex]);
+
+                elementIndex = this->elementNodes.at(elementIndex).next;
+            }
+
+            colliderIndices = leafColliders.data();
+            tops = leafTops.data();
+            bottoms = leafBottoms.data();
+            lefts = leafLefts.data();
+            rights = leafRights.data();
+        }
+
+        for (int a = 0; a < numColliders; a++)
+        {
+            forEachOverlap(tops, bottoms, lefts, rights, a + 1, numColliders, tops[a], bottoms[a], lefts[a], rights[a],
+                [&](int b)
+            {
+                /* Both colliders occupy every leaf that contains the bottom left corner of their overlap, so
+                 * the pair is only reported by the single leaf containing that corner. */
+                const CoordType cornerX = std::max(std::max(lefts[a], lefts[b]), this->leftBound),
+                    cornerY = std::max(std::max(bottoms[a], bottoms[b]), this->bottomBound);
+
+                if (cornerX >= leaf.left && cornerX < leaf.right && cornerY >= leaf.bottom && cornerY < leaf.top)
+                {
+                    ColliderPair<CoordType>& pair = output->at(output->pushBack());
+
+                    pair.first = this->colliders.at(colliderIndices[a]);
+                    pair.second = this->colliders.at(colliderIndices[b]);
+                }
+
+                return true;
+            });
+        }
+    }
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::findAllPairs(const QuadTree<CoordType>& other, FreeList<ColliderPair<CoordType>>* output) const
+{
+    /* A node of each quadtree, with overlapping boundaries. */
+    struct NodePair
+    {
+        QuadNodeData<CoordType> first, second;
+    };
+
+    const auto nodesOverlap = [](const QuadNodeData<CoordType>& first, const QuadNodeData<CoordType>& second)
+    {
+        return std::max(first.left, second.left) < std::min(first.right, second.right) &&
+            std::max(first.bottom, second.bottom) < std::min(first.top, second.top);
+    };
+
+    const QuadNodeData<CoordType> firstRoot(this->rootNodeIndex, 0, this->topBound, this->bottomBound, this->leftBound,
+        this->rightBound), secondRoot(other.rootNodeIndex, 0, other.topBound, other.bottomBound, other.leftBound,
+        other.rightBound);
+
+    /* The bottom left corner of the region covered by both quadtrees. */
+    const CoordType sharedLeft = std::max(this->leftBound, other.leftBound),
+        sharedBottom = std::max(this->bottomBound, other.bottomBound);
+
+    std::vector<NodePair> toProcess;
+
+    /* Scratch arrays that the other quadtree's unpacked leaves are gathered into. */
+    std::vector<int> leafColliders;
+    std::vector<CoordType> leafTops, leafBottoms, leafLefts, leafRights;
+
+    if (nodesOverlap(firstRoot, secondRoot))
+        toProcess.push_back({ firstRoot, secondRoot });
+
+    while (toProcess.size())
+    {
+        const NodePair nodes = toProcess.back();
+        const QuadNode& first = this->quadNodes.at(nodes.first.quadNodeIndex);
+        const QuadNode& second = other.quadNodes.at(nodes.second.quadNodeIndex);
+        const bool firstIsBranch = first.numElements == QuadNode::BRANCH_NODE,
+            secondIsBranch = second.numElements == QuadNode::BRANCH_NODE;
+
+        toProcess.pop_back();
+
+        /* Both nodes are split at the same point, so each child only overlaps its counterpart. */
+        if (firstIsBranch && secondIsBranch && nodes.first.top == nodes.second.top &&
+            nodes.first.bottom == nodes.second.bottom && nodes.first.left == nodes.second.left &&
+            nodes.first.right == nodes.second.right)
+        {
+            for (int i = 0; i < 4; i++)
+                toProcess.push_back({ childNodeData(nodes.first, first.firstChild, i),
+                    childNodeData(nodes.second, second.firstChild, i) });
+
+            continue;
+        }
+
+        /* Otherwise split the wider branch and keep the children that overlap the other node. */
+        if (firstIsBranch && (!secondIsBranch ||
+            nodes.first.right - nodes.first.left >= nodes.second.right - nodes.second.left))
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                const QuadNodeData<CoordType> child = childNodeData(nodes.first, first.firstChild, i);
+
+                if (nodesOverlap(child, nodes.second))
+                    toProcess.push_back({ child, nodes.second });
+            }
+
+            continue;
+        }
+
+        if (secondIsBranch)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                const QuadNodeData<CoordType> child = childNodeData(nodes.second, second.firstChild, i);
+
+                if (nodesOverlap(nodes.first, child))
+                    toProcess.push_back({ nodes.first, child });
+            }
+
+            continue;
+        }
+
+        if (first.numElements == 0 || second.numElements == 0)
+            continue;
+
+        const int* colliderIndices;
+        const CoordType *tops, *bottoms, *lefts, *rights;
+
+        if (other.leavesPacked)
+        {
+            const int offset = other.packedOffsets[nodes.second.quadNodeIndex];
+
+            colliderIndices = other.packedColliders.data() + offset;
+            tops = other.packedTops.data() + offset;
+            bottoms = other.packedBottoms.data() + offset;
+            lefts = other.packedLefts.data() + offset;
+            rights = other.packedRights.data() + offset;
+        }
+        else
+        {
+            leafColliders.clear();
+            leafTops.clear();
+            leafBottoms.clear();
+            leafLefts.clear();
+            leafRights.clear();
+
+            for (int element = second.firstChild; element != ElementNode::NONE; element = other.elementNodes.at(element).next)
+            {
+                const int colliderIndex = other.elementNodes.at(element).colliderIndex;
+
+                leafColliders.push_back(colliderIndex);
+                leafTops.push_back(other.colliderTops[colliderIndex]);
+                leafBottoms.push_back(other.colliderBottoms[colliderIndex]);
+                leafLefts.push_back(other.colliderLefts[colliderIndex]);
+                leafRights.push_back(other.colliderRights[colliderIndex]);
+            }
+
+            colliderIndices = leafColliders.data();
+            tops = leafTops.data();
+            bottoms = leafBottoms.data();
+            lefts = leafLefts.data();
+            rights = leafRights.data();
+        }
+
+        /* The part of the world covered by both leaves. */
+        const CoordType top = std::min(nodes.first.top, nodes.second.top),
+            bottom = std::max(nodes.first.bottom, nodes.second.bottom),
+            left = std::max(nodes.first.left, nodes.second.left), right = std::min(nodes.first.right, nodes.second.right);
+
+        for (int element = first.firstChild; element != ElementNode::NONE; element = this->elementNodes.at(element).next)
+        {
+            const int colliderIndex = this->elementNodes.at(element).colliderIndex;
+            const CoordType colliderTop = this->colliderTops[colliderIndex], colliderBottom = this->colliderBottoms[colliderIndex],
+                colliderLeft = this->colliderLefts[colliderIndex], colliderRight = this->colliderRights[colliderIndex];
+
+            forEachOverlap(tops, bottoms, lefts, rights, 0, second.numElements, colliderTop, colliderBottom, colliderLeft,
+                colliderRight, [&](int b)
+            {
+                /* As in a single quadtree, the pair is only reported by the pair of leaves containing the bottom
+                 * left corner of the overlap, clamped to the shared region. */
+                const CoordType cornerX = std::max(std::max(colliderLeft, lefts[b]), sharedLeft),
+                    cornerY = std::max(std::max(colliderBottom, bottoms[b]), sharedBottom);
+
+                if (cornerX >= left && cornerX < right && cornerY >= bottom && cornerY < top &&
+                    cornerX <= std::min(colliderRight, rights[b]) && cornerY <= std::min(colliderTop, tops[b]))
+                {
+                    ColliderPair<CoordType>& pair = output->at(output->pushBack());
+
+                    pair.first = this->colliders.at(colliderIndex);
+                    pair.second = other.colliders.at(colliderIndices[b]);
+                }
+
+                return true;
+            });
+        }
+    }
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::build(QuadTreeCollider<CoordType>* const* colliderArray, int numColliders, int numThreads)
+{
+    this->leavesPacked = false;
+    this->quadNodes.clear();
+    this->elementNodes.clear();
+    this->colliders.clear();
+
+    std::vector<int> partitions;
+
+    partitions.reserve(numColliders);
+
+    for (int i = 0; i < numColliders; i++)
+    {
+        const QuadTreeCollider<CoordType>* colliderPtr = colliderArray[i];
+        const int colliderIndex = this->colliders.insert();
+
+        this->colliders.at(colliderIndex) = colliderArray[i];
+        this->setBounds(colliderIndex, *colliderPtr);
+        this->colliderCategories[colliderIndex] = ALL_CATEGORIES;
+
+        /* Colliders outside the boundaries are registered but occupy no leaves, as with insert. */
+        if (colliderPtr->bottom < this->topBound && colliderPtr->top >= this->bottomBound &&
+            colliderPtr->left < this->rightBound && colliderPtr->right >= this->leftBound)
+            partitions.push_back(colliderIndex);
+    }
+
+    this->rootNodeIndex = this->quadNodes.insert();
+    this->cleanupStack.clear();
+
+    if (numThreads < 1)
+        numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+
+    if (numThreads > 1)
+        this->buildParallel(&partitions, numThreads);
+    else
+        this->buildSubtree(&this->quadNodes, &this->elementNodes, &partitions, QuadNodeData<CoordType>(this->rootNodeIndex, 0,
+            this->topBound, this->bottomBound, this->leftBound, this->rightBound));
+
+    this->relinkElements();
+    this->recomputeCategories();
+    this->rebuildGrid();
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::clearElements()
+{
+    this->leavesPacked = false;
+    this->elementNodes.clear();
+    this->colliders.clear();
+
+    FreeList<int> leafIndices;
+    this->getAllLeaves(&leafIndices);
+
+    const int numLeaves = leafIndices.size();
+
+    std::fill(this->nodeCategories.begin(), this->nodeCategories.end(), 0);
+
+    /* The quadnode freelist shouldn't be cleared, because it will have to be reconstructed soon. */
+    for (int i = 0; i < numLeaves; i++)
+    {
+        this->quadNodes.at(leafIndices.at(i)).firstChild = ElementNode::NONE;
+        this->quadNodes.at(leafIndices.at(i)).numElements = 0;
+    }
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::getAllLeaves(FreeList<int>* nodeIndices)
+{
+    FreeList<int> toProcess;
+
+    toProcess.at(toProcess.pushBack()) = this->rootNodeIndex;
+
+    while (toProcess.size())
+    {
+        const int quadNodeIndex = toProcess.at(toProcess.size() - 1),
+            numElements = this->quadNodes.at(quadNodeIndex).numElements,
+            first = this->quadNodes.at(quadNodeIndex).firstChild;
+
+        toProcess.popBack();
+
+        int newIndex;
+
+        /* In this case, we have a leaf node. */
+        if (numElements != QuadNode::BRANCH_NODE)
+            nodeIndices->at(nodeIndices->pushBack()) = quadNodeIndex;
+        /* Otherwise, we push back the indices of all the quadnode children. */
+        else for (int i = 0; i < 4; i++)
+            toProcess.at(toProcess.pushBack()) = first + i;
+    }
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::getAllLeafDatas(FreeList<QuadNodeData<CoordType>>* quadNodeDatas)
+{
+    this->getLeaves(quadNodeDatas, this->topBound, this->bottomBound,
+        this->leftBound, this->rightBound, 0, 0, this->topBound,
+        this->bottomBound, this->leftBound, this->rightBound, 0);
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::packLeaves()
+{
+    FreeList<int> leafIndices;
+
+    this->getAllLeaves(&leafIndices);
+
+    const int numLeaves = leafIndices.size();
+    int numEntries = 0;
+
+    this->packedOffsets.resize(this->quadNodes.size());
+
+    for (int i = 0; i < numLeaves; i++)
+    {
+        this->packedOffsets[leafIndices.at(i)] = numEntries;
+        numEntries += this->quadNodes.at(leafIndices.at(i)).numElements;
+    }
+
+    this->packedColliders.resize(numEntries);
+    this->packedTops.resize(numEntries);
+    this->packedBottoms.resize(numEntries);
+    this->packedLefts.resize(numEntries);
+    this->packedRights.resize(numEntries);
+
+    for (int i = 0; i < numLeaves; i++)
+    {
+        int entry = this->packedOffsets[leafIndices.at(i)],
+            elementIndex = this->quadNodes.at(leafIndices.at(i)).firstChild;
+
+        while (elementIndex != ElementNode::NONE)
+        {
+            const int colliderIndex = this->elementNodes.at(elementIndex).colliderIndex;
+
+            this->packedColliders[entry] = colliderIndex;
+            this->packedTops[entry] = this->colliderTops[colliderIndex];
+            this->packedBottoms[entry] = this->colliderBottoms[colliderIndex];
+            this->packedLefts[entry] = this->colliderLefts[colliderIndex];
+            this->packedRights[entry] = this->colliderRights[colliderIndex];
+
+            entry++;
+            elementIndex = this->elementNodes.at(elementIndex).next;
+        }
+    }
+
+    this->leavesPacked = true;
+}
+
+template<typename CoordType>
+CompactionResult QuadTree<CoordType>::compact()
+{
+    FreeList<QuadNode> newQuadNodes;
+    FreeList<ElementNode> newElementNodes;
+
+    /* Pairs of old and new quadnode indices still to be copied. */
+    FreeList<int> oldIndices, newIndices;
+
+    /* Returns the bytes allocated by the lists and the arrays indexed by their slots. */
+    const auto allocatedBytes = [this]()
+    {
+        const auto vectorBytes = [](const auto& array)
+        {
+            return (long long)array.capacity() * (long long)sizeof(array[0]);
+        };
+
+        return (long long)this->quadNodes.getCapacity() * (long long)sizeof(QuadNode) +
+            (long long)this->elementNodes.getCapacity() * (long long)sizeof(ElementNode) +
+            vectorBytes(this->elementLeaves) + vectorBytes(this->elementPrevious) +
+            vectorBytes(this->elementColliderNext) + vectorBytes(this->nodeCategories) +
+            vectorBytes(this->packedOffsets) + vectorBytes(this->packedColliders) + vectorBytes(this->packedTops) +
+            vectorBytes(this->packedBottoms) + vectorBytes(this->packedLefts) + vectorBytes(this->packedRights);
+    };
+
+    const long long bytesBefore = allocatedBytes();
+
+    this->leavesPacked = false;
+
+    oldIndices.at(oldIndices.pushBack()) = this->rootNodeIndex;
+    newIndices.at(newIndices.pushBack()) = newQuadNodes.insert();
+
+    while (oldIndices.size())
+    {
+        const int oldIndex = oldIndices.at(oldIndices.size() - 1), newIndex = newIndices.at(newIndices.size() - 1);
+        const QuadNode oldNode = this->quadNodes.at(oldIndex);
+
+        oldIndices.popBack();
+        newIndices.popBack();
+
+        /* Copy the leaf's element list into consecutive element nodes, preserving its order. */
+        if (oldNode.numElements != QuadNode::BRANCH_NODE)
+        {
+            int oldElement = oldNode.firstChild, previous = ElementNode::NONE;
+
+            newQuadNodes.at(newIndex).firstChild = ElementNode::NONE;
+            newQuadNodes.at(newIndex).numElements = oldNode.numElements;
+
+            while (oldElement != ElementNode::NONE)
+            {
+                const int newElement = newElementNodes.insert();
+
+                newElementNodes.at(newElement).colliderIndex = this->elementNodes.at(oldElement).colliderIndex;
+                newElementNodes.at(newElement).next = ElementNode::NONE;
+
+                if (previous == ElementNode::NONE)
+                    newQuadNodes.at(newIndex).firstChild = newElement;
+                else
+                    newElementNodes.at(previous).next = newElement;
+
+                previous = newElement;
+                oldElement = this->elementNodes.at(oldElement).next;
+            }
+
+            continue;
+        }
+
+        const int firstChild = newQuadNodes.insert();
+
+        newQuadNodes.insert();
+        newQuadNodes.insert();
+        newQuadNodes.insert();
+
+        newQuadNodes.at(newIndex).firstChild = firstChild;
+        newQuadNodes.at(newIndex).numElements = QuadNode::BRANCH_NODE;
+
+        /* Push the children in reverse so that the first child's subtree is laid out first. */
+        for (int i = 3; i >= 0; i--)
+        {
+            oldIndices.at(oldIndices.pushBack()) = oldNode.firstChild + i;
+            newIndices.at(newIndices.pushBack()) = firstChild + i;
+        }
+    }
+
+    const int quadNodesReclaimed = this->quadNodes.getCapacity() - newQuadNodes.getCapacity(),
+        elementNodesReclaimed = this->elementNodes.getCapacity() - newElementNodes.getCapacity();
+
+    /* Assignment allocates only the capacity of the new lists and releases the old storage. */
+    this->quadNodes = newQuadNodes;
+    this->elementNodes = newElementNodes;
+    this->rootNodeIndex = 0;
+    this->cleanupStack.clear();
+
+    /* The arrays indexed by quadnode or element node index only ever grow, so they are replaced by fresh ones
+     * that relinkElements and recomputeCategories allocate at the size of the new lists. */
+    std::vector<int>().swap(this->elementLeaves);
+    std::vector<int>().swap(this->elementPrevious);
+    std::vector<int>().swap(this->elementColliderNext);
+    std::vector<std::uint32_t>().swap(this->nodeCategories);
+
+    /* The packed leaves refer to the old element order, so they are released until packLeaves is called again. */
+    std::vector<int>().swap(this->packedOffsets);
+    std::vector<int>().swap(this->packedColliders);
+    std::vector<CoordType>().swap(this->packedTops);
+    std::vector<CoordType>().swap(this->packedBottoms);
+    std::vector<CoordType>().swap(this->packedLefts);
+    std::vector<CoordType>().swap(this->packedRights);
+
+    this->relinkElements();
+    this->recomputeCategories();
+    this->rebuildGrid();
+
+    return CompactionResult(quadNodesReclaimed, elementNodesReclaimed, bytesBefore - allocatedBytes());
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::setMergeThreshold(int threshold)
+{
+    assert(threshold >= 0 && threshold <= this->maxEltsPerNode);
+
+    this->mergeThreshold = threshold;
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::cleanup()
+{
+    /* Abandon any incremental pass in progress and run a complete one. */
+    this->cleanupStack.clear();
+    this->runCleanup(-1, nullptr);
+
+    if (this->categoriesUsed)
+        this->recomputeCategories();
+
+    if (this->gridStale)
+        this->rebuildGrid();
+}
+
+template<typename CoordType>
+bool QuadTree<CoordType>::cleanupIncremental(int nodeBudget)
+{
+    const bool finished = this->runCleanup(nodeBudget, nullptr);
+
+    /* Categories left behind by removals are dropped once per pass. */
+    if (finished && this->categoriesUsed)
+        this->recomputeCategories();
+    if (this->gridStale)
+        this->rebuildGrid();
+
+    return finished;
+}
+
+template<typename CoordType>
+bool QuadTree<CoordType>::cleanupIncremental(std::chrono::microseconds timeBudget)
+{
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeBudget;
+    const bool finished = this->runCleanup(-1, &deadline);
+
+    if (finished && this->categoriesUsed)
+        this->recomputeCategories();
+    if (this->gridStale)
+        this->rebuildGrid();
+
+    return finished;
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::setGridDepth(int depth)
+{
+    assert(depth >= 0 && depth <= this->maxDivisions && depth < 16);
+
+    this->gridDepth = depth;
+    this->gridColumnShift = this->gridRowShift = -1;
+
+    /* Descents starting from a grid do not add categories to the nodes above it. */
+    this->recomputeCategories();
+
+    if (depth == 0)
+    {
+        this->gridNodes.clear();
+        this->gridColumnBounds.clear();
+        this->gridRowBounds.clear();
+        this->gridStale = false;
+        return;
+    }
+
+    const int numCells = 1 << depth;
+
+    /* Split the boundaries exactly as the quadtree does, so that every cell matches a node at the grid depth. */
+    const auto splitBounds = [numCells](std::vector<CoordType>* cellBounds, CoordType low, CoordType high)
+    {
+        cellBounds->assign(numCells + 1, low);
+        (*cellBounds)[numCells] = high;
+
+        for (int step = numCells / 2; step > 0; step /= 2)
+            for (int i = step; i < numCells; i += 2 * step)
+                (*cellBounds)[i] = quadMidpoint((*cellBounds)[i - step], (*cellBounds)[i + step]);
+
+        for (int i = 0; i < numCells; i++)
+            assert((*cellBounds)[i] < (*cellBounds)[i + 1]);
+    };
+
+    splitBounds(&this->gridColumnBounds, this->leftBound, this->rightBound);
+    splitBounds(&this->gridRowBounds, this->bottomBound, this->topBound);
+
+    /* Cells of a power of two wide quadtree are found with a shift instead of a binary search. */
+    if constexpr (std::is_integral<CoordType>::value)
+    {
+        const auto cellShift = [depth](CoordType low, CoordType high)
+        {
+            const unsigned long long size = (unsigned long long)(high - low);
+            int shift = 0;
+
+            if (size & (size - 1))
+                return -1;
+
+            while ((1ull << shift) < size)
+                shift++;
+
+            return shift - depth;
+        };
+
+        this->gridColumnShift = cellShift(this->leftBound, this->rightBound);
+        this->gridRowShift = cellShift(this->bottomBound, this->topBound);
+    }
+
+    this->gridNodes.assign((size_t)numCells * numCells, QuadNodeData<CoordType>());
+    this->rebuildGrid();
+}
+
+template<typename CoordType>
+bool QuadTree<CoordType>::runCleanup(int nodeBudget, const std::chrono::steady_clock::time_point* deadline)
+{
+    /* Checking the clock after every node would cost more than most nodes take to examine. */
+    const int nodesPerClockCheck = 64;
+
+    int nodesVisited = 0, nextClockCheck = nodesPerClockCheck;
+
+    /* Start a new pass from the root. Nodes only leave the stack once examined, and merging never frees a
+     * node that is still on it, so a pass can safely resume after the quadtree has been modified. */
+    if (this->cleanupStack.size() == 0)
+    {
+        if (this->quadNodes.at(this->rootNodeIndex).numElements != QuadNode::BRANCH_NODE)
+            return true;
+
+        this->cleanupStack.at(this->cleanupStack.pushBack()) = this->rootNodeIndex;
+    }
+
+    this->leavesPacked = false;
+
+    while (this->cleanupStack.size())
+    {
+        if (nodeBudget >= 0 && nodesVisited >= nodeBudget)
+            return false;
+
+        if (deadline && nodesVisited >= nextClockCheck)
+        {
+            if (std::chrono::steady_clock::now() >= *deadline)
+                return false;
+
+            nextClockCheck = nodesVisited + nodesPerClockCheck;
+        }
+
+        const int nodeIndex = this->cleanupStack.at(this->cleanupStack.size() - 1);
+
+        this->cleanupStack.popBack();
+
+        /* Insertions may only turn leaves into branches, but check in case the node has changed. */
+        if (this->quadNodes.at(nodeIndex).numElements != QuadNode::BRANCH_NODE)
+            continue;
+
+        nodesVisited += this->markSubtree(nodeIndex);
+
+        FreeList<int>& usedIndices = this->queryContext.usedIndices;
+
+        if (usedIndices.size() < this->mergeThreshold)
+            this->mergeSubtree(nodeIndex);
+        else
+        {
+            const int firstChild = this->quadNodes.at(nodeIndex).firstChild;
+
+            for (int i = 0; i < 4; i++)
+                if (this->quadNodes.at(firstChild + i).numElements == QuadNode::BRANCH_NODE)
+                    this->cleanupStack.at(this->cleanupStack.pushBack()) = firstChild + i;
+        }
+    }
+
+    return true;
+}
+
+template<typename CoordType>
+int QuadTree<CoordType>::markSubtree(int quadNodeIndex)
+{
+    FreeList<int> toProcess;
+    FreeList<int>& usedIndices = this->queryContext.usedIndices;
+    std::vector<unsigned int>& queryStamps = this->queryContext.queryStamps;
+    const unsigned int stamp = this->queryContext.nextStamp(this->colliders.size());
+
+    int nodesVisited = 0;
+
+    usedIndices.clear();
+    toProcess.at(toProcess.pushBack()) = quadNodeIndex;
+
+    while (toProcess.size() && usedIndices.size() < this->mergeThreshold)
+    {
+        const QuadNode node = this->quadNodes.at(toProcess.at(toProcess.size() - 1));
+
+        toProcess.popBack();
+        nodesVisited++;
+
+        if (node.numElements == QuadNode::BRANCH_NODE)
+        {
+            for (int i = 0; i < 4; i++)
+                toProcess.at(toProcess.pushBack()) = node.firstChild + i;
+
+            continue;
+        }
+
+        for (int element = node.firstChild; element != ElementNode::NONE; element = this->elementNodes.at(element).next)
+        {
+            const int colliderIndex = this->elementNodes.at(element).colliderIndex;
+
+            if (queryStamps[colliderIndex] != stamp)
+            {
+                queryStamps[colliderIndex] = stamp;
+                usedIndices.at(usedIndices.pushBack()) = colliderIndex;
+            }
+        }
+    }
+
+    return nodesVisited;
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::mergeSubtree(int quadNodeIndex)
+{
+    FreeList<int> toProcess, childGroups, elements;
+
+    /* Collect the child groups and element nodes of the subtree first, because erasing a node overwrites
+     * its contents. */
+    toProcess.at(toProcess.pushBack()) = quadNodeIndex;
+
+    while (toProcess.size())
+    {
+        const QuadNode node = this->quadNodes.at(toProcess.at(toProcess.size() - 1));
+
+        toProcess.popBack();
+
+        if (node.numElements == QuadNode::BRANCH_NODE)
+        {
+            childGroups.at(childGroups.pushBack()) = node.firstChild;
+
+            for (int i = 0; i < 4; i++)
+                toProcess.at(toProcess.pushBack()) = node.firstChild + i;
+        }
+        else for (int element = node.firstChild; element != ElementNode::NONE; element = this->elementNodes.at(element).next)
+            elements.at(elements.pushBack()) = element;
+    }
+
+    for (int i = 0; i < elements.size(); i++)
+    {
+        this->unlinkColliderElement(this->elementNodes.at(elements.at(i)).colliderIndex, elements.at(i));
+        this->elementNodes.erase(elements.at(i));
+    }
+
+    /* Remove all four children in reverse order so the memory vacancies can be reclaimed
+     * in subsequent iterations in proper order. */
+    for (int i = 0; i < childGroups.size(); i++)
+    {
+        const int firstChild = childGroups.at(i);
+
+        this->quadNodes.erase(firstChild + 3);
+        this->quadNodes.erase(firstChild + 2);
+        this->quadNodes.erase(firstChild + 1);
+        this->quadNodes.erase(firstChild);
+    }
+
+    /* The node becomes a leaf holding each of the subtree's colliders once. There are fewer of them than
+     * the merge threshold, so it will not be subdivided again straight away. */
+    /* Cells referring to the erased nodes are repointed once the cleanup call ends. */
+    this->gridStale = this->gridDepth > 0;
+
+    const FreeList<int>& usedIndices = this->queryContext.usedIndices;
+    QuadNode& node = this->quadNodes.at(quadNodeIndex);
+
+    node.firstChild = ElementNode::NONE;
+    node.numElements = usedIndices.size();
+    this->nodeCategories[quadNodeIndex] = 0;
+
+    for (int i = 0; i < usedIndices.size(); i++)
+    {
+        const int newElementIndex = this->elementNodes.insert();
+
+        this->elementNodes.at(newElementIndex).colliderIndex = usedIndices.at(i);
+        this->elementNodes.at(newElementIndex).next = node.firstChild;
+
+        node.firstChild = newElementIndex;
+        this->linkElement(newElementIndex, quadNodeIndex, ElementNode::NONE);
+        this->nodeCategories[quadNodeIndex] |= this->colliderCategories[usedIndices.at(i)];
+    }
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::getLeaves(FreeList<QuadNodeData<CoordType>>* output, CoordType colliderTop, CoordType colliderBottom, CoordType colliderLeft, CoordType colliderRight,
+        int quadNodeIndex, int depth, CoordType top, CoordType bottom, CoordType left, CoordType right, std::uint32_t categories)
+{
+    FreeList<QuadNodeData<CoordType>> processingStack;
+
+    this->getLeaves(output, &processingStack, colliderTop, colliderBottom, colliderLeft, colliderRight,
+        quadNodeIndex, depth, top, bottom, left, right, categories);
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::getLeaves(FreeList<QuadNodeData<CoordType>>* output, FreeList<QuadNodeData<CoordType>>* processingStack, CoordType colliderTop,
+        CoordType colliderBottom, CoordType colliderLeft, CoordType colliderRight, int quadNodeIndex, int depth, CoordType top,
+        CoordType bottom, CoordType left, CoordType right, std::uint32_t categories)
+{
+    /* Return early if the collider is not contained within the boundaries. */
+    if (top <= colliderBottom ||
+        bottom > colliderTop ||
+        right <= colliderLeft ||
+        left > colliderRight)
+        return;
+
+    processingStack->clear();
+
+    /* Start from the grid rather than descending from the root through the levels above it. */
+    if (quadNodeIndex == this->rootNodeIndex && this->gridDepth > 0)
+        this->pushGridNodes(processingStack, colliderTop, colliderBottom, colliderLeft, colliderRight);
+    else
+        pushBackNode(processingStack, quadNodeIndex, depth, top, bottom, left, right);
+
+    while (processingStack->size() > 0)
+    {
+        const QuadNodeData<CoordType> topData = processingStack->at(processingStack->size() - 1);
+        processingStack->popBack();
+
+        this->nodeCategories[topData.quadNodeIndex] |= categories;
+
+        /* In this case, we've found a leaf node. */
+        if (this->quadNodes.at(topData.quadNodeIndex).numElements != QuadNode::BRANCH_NODE)
+            output->at(output->pushBack()) = topData;
+        else
+        {
+            const int firstChild = this->quadNodes.at(topData.quadNodeIndex).firstChild;
+            const CoordType halfX = quadMidpoint(topData.left, topData.right),
+                halfY = quadMidpoint(topData.bottom, topData.top);
+
+            if (colliderLeft < halfX)
+            {
+                /* Top left. */
+                if (colliderTop >= halfY)
+                    pushBackNode(processingStack, firstChild, topData.depth + 1, topData.top, halfY, topData.left, halfX);
+                /* Bottom left. */
+                if (colliderBottom < halfY)
+                    pushBackNode(processingStack, firstChild + 2, topData.depth + 1, halfY, topData.bottom, topData.left, halfX);
+            }
+            if (colliderRight >= halfX)
+            {
+                /* Top right. */
+                if (colliderTop >= halfY)
+                    pushBackNode(processingStack, firstChild + 1, topData.depth + 1, topData.top, halfY, halfX, topData.right);
+                /* Bottom right. */
+                if (colliderBottom < halfY)
+                    pushBackNode(processingStack, firstChild + 3, topData.depth + 1, halfY, topData.bottom, halfX, topData.right);
+            }
+        }
+    }
+}
+
+template<typename CoordType>
+int QuadTree<CoordType>::gridCell(const std::vector<CoordType>& cellBounds, int shift, CoordType value) const
+{
+    const int lastCell = (int)cellBounds.size() - 2;
+
+    if constexpr (std::is_integral<CoordType>::value)
+    {
+        if (shift >= 0)
+        {
+            if (value < cellBounds.front())
+                return 0;
+            if (value >= cellBounds.back())
+                return lastCell;
+
+            return (int)((value - cellBounds.front()) >> shift);
+        }
+    }
+
+    /* Count the inner boundaries at or below the value, matching the half-open children of the quadtree. */
+    return (int)(std::upper_bound(cellBounds.begin() + 1, cellBounds.end() - 1, value) - (cellBounds.begin() + 1));
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::pushGridNodes(FreeList<QuadNodeData<CoordType>>* processingStack, CoordType colliderTop,
+    CoordType colliderBottom, CoordType colliderLeft, CoordType colliderRight) const
+{
+    const int numColumns = 1 << this->gridDepth;
+    const int firstColumn = this->gridCell(this->gridColumnBounds, this->gridColumnShift, colliderLeft),
+        lastColumn = this->gridCell(this->gridColumnBounds, this->gridColumnShift, colliderRight),
+        firstRow = this->gridCell(this->gridRowBounds, this->gridRowShift, colliderBottom),
+        lastRow = this->gridCell(this->gridRowBounds, this->gridRowShift, colliderTop);
+
+    for (int row = firstRow; row <= lastRow; row++)
+    {
+        int column = firstColumn;
+
+        while (column <= lastColumn)
+        {
+            const QuadNodeData<CoordType>& data = this->gridNodes[row * numColumns + column];
+            const int span = 1 << (this->gridDepth - data.depth), mask = ~(span - 1);
+
+            /* A leaf above the grid depth covers a block of cells, so it is pushed from the first row of the
+             * block within the range only, and the rest of the block's row is skipped. */
+            if (row == std::max(firstRow, row & mask))
+                processingStack->at(processingStack->pushBack()) = data;
+
+            column = (column & mask) + span;
+        }
+    }
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::setGridNode(const QuadNodeData<CoordType>& data)
+{
+    assert(data.depth <= this->gridDepth);
+
+    const int numColumns = 1 << this->gridDepth, span = 1 << (this->gridDepth - data.depth);
+    const int firstColumn = this->gridCell(this->gridColumnBounds, this->gridColumnShift, data.left),
+        firstRow = this->gridCell(this->gridRowBounds, this->gridRowShift, data.bottom);
+
+    for (int row = firstRow; row < firstRow + span; row++)
+        for (int column = firstColumn; column < firstColumn + span; column++)
+            this->gridNodes[row * numColumns + column] = data;
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::rebuildGrid()
+{
+    FreeList<QuadNodeData<CoordType>> toProcess;
+
+    this->gridStale = false;
+
+    if (this->gridDepth == 0)
+        return;
+
+    pushBackNode(&toProcess, this->rootNodeIndex, 0, this->topBound, this->bottomBound, this->leftBound, this->rightBound);
+
+    while (toProcess.size())
+    {
+        const QuadNodeData<CoordType> data = toProcess.at(toProcess.size() - 1);
+        const QuadNode& node = this->quadNodes.at(data.quadNodeIndex);
+
+        toProcess.popBack();
+
+        if (node.numElements != QuadNode::BRANCH_NODE || data.depth == this->gridDepth)
+        {
+            this->setGridNode(data);
+            continue;
+        }
+
+        for (int i = 0; i < 4; i++)
+            toProcess.at(toProcess.pushBack()) = childNodeData(data, node.firstChild, i);
+    }
+}
+
+template<typename CoordType>
+template<typename LeafVisitor>
+void QuadTree<CoordType>::traverseRay(QueryContext<CoordType>* context, double originX, double originY,
+    double directionX, double directionY, double maxT, LeafVisitor visitLeaf) const
+{
+    FreeList<QuadNodeData<CoordType>>* processingStack = &context->processingStack;
+    double cutoff = maxT, entry;
+
+    processingStack->clear();
+
+    if (!rayBoxEntry(originX, originY, directionX, directionY, cutoff, this->topBound, this->bottomBound,
+        this->leftBound, this->rightBound, &entry))
+        return;
+
+    pushBackNode(processingStack, this->rootNodeIndex, 0, this->topBound, this->bottomBound, this->leftBound, this->rightBound);
+
+    while (processingStack->size() > 0)
+    {
+        const QuadNodeData<CoordType> data = processingStack->at(processingStack->size() - 1);
+        const QuadNode& node = this->quadNodes.at(data.quadNodeIndex);
+
+        processingStack->popBack();
+        QUADTREE_COUNT(context->counters.nodesVisited, 1);
+
+        /* Skip nodes the ray only enters after the cutoff, which may have shrunk since the node was pushed. */
+        if (!rayBoxEntry(originX, originY, directionX, directionY, cutoff, data.top, data.bottom, data.left, data.right, &entry))
+            continue;
+
+        if (node.numElements != QuadNode::BRANCH_NODE)
+        {
+            cutoff = visitLeaf(data.quadNodeIndex);
+            continue;
+        }
+
+        /* Order the children the ray enters by entry parameter, then push them farthest first so that the
+         * nearest is visited next. */
+        double childEntries[4];
+        int order[4], numHit = 0;
+
+        for (int i = 0; i < 4; i++)
+        {
+            const QuadNodeData<CoordType> child = childNodeData(data, node.firstChild, i);
+
+            if (!rayBoxEntry(originX, originY, directionX, directionY, cutoff, child.top, child.bottom, child.left,
+                child.right, &childEntries[i]))
+                continue;
+
+            int position = numHit++;
+
+            for (; position > 0 && childEntries[order[position - 1]] > childEntries[i]; position--)
+                order[position] = order[position - 1];
+
+            order[position] = i;
+        }
+
+        for (int i = numHit - 1; i >= 0; i--)
+            processingStack->at(processingStack->pushBack()) = childNodeData(data, node.firstChild, order[i]);
+    }
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::setBounds(int colliderIndex, const QuadTreeCollider<CoordType>& bounds)
+{
+    /* The collider freelist only grows one index at a time, so growing the arrays to its size suffices. */
+    if ((int)this->colliderTops.size() <= colliderIndex)
+    {
+        const int newSize = this->colliders.size();
+
+        this->colliderTops.resize(newSize);
+        this->colliderBottoms.resize(newSize);
+        this->colliderLefts.resize(newSize);
+        this->colliderRights.resize(newSize);
+        this->colliderFirstElements.resize(newSize, ElementNode::NONE);
+        this->colliderCategories.resize(newSize);
+    }
+
+    this->colliderTops[colliderIndex] = bounds.top;
+    this->colliderBottoms[colliderIndex] = bounds.bottom;
+    this->colliderLefts[colliderIndex] = bounds.left;
+    this->colliderRights[colliderIndex] = bounds.right;
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::nodeInsert(int colliderIndex, const QuadNodeData<CoordType>& data)
+{
+    QuadNode& quadNode = this->quadNodes.at(data.quadNodeIndex);
+
+    /* Create an element node and push it back in the quadnode list. */
+    const int newElementIndex = this->elementNodes.insert();
+
+    ElementNode& newElement = this->elementNodes.at(newElementIndex);
+
+    newElement.colliderIndex = colliderIndex;
+    newElement.next = quadNode.firstChild;
+
+    quadNode.firstChild = newElementIndex;
+    this->linkElement(newElementIndex, data.quadNodeIndex, ElementNode::NONE);
+
+    /* Subdivide the node if needed and allowed. */
+    if (++quadNode.numElements > this->maxEltsPerNode && data.depth < this->maxDivisions)
+    {
+        this->subdivideNode(data.quadNodeIndex, data.depth, data.top, data.bottom, data.left, data.right);
+    }
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::linkElement(int elementIndex, int quadNodeIndex, int previous)
+{
+    /* Bulk builds allocate many element nodes before linking any, and the next element of a list may have a
+     * higher index than this one, so the arrays are grown to the whole freelist. */
+    if ((int)this->elementLeaves.size() < this->elementNodes.size())
+    {
+        const int newSize = this->elementNodes.size();
+
+        this->elementLeaves.resize(newSize);
+        this->elementPrevious.resize(newSize);
+        this->elementColliderNext.resize(newSize);
+    }
+
+    const ElementNode& element = this->elementNodes.at(elementIndex);
+
+    this->elementLeaves[elementIndex] = quadNodeIndex;
+    this->elementPrevious[elementIndex] = previous;
+
+    if (element.next != ElementNode::NONE)
+        this->elementPrevious[element.next] = elementIndex;
+
+    this->elementColliderNext[elementIndex] = this->colliderFirstElements[element.colliderIndex];
+    this->colliderFirstElements[element.colliderIndex] = elementIndex;
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::unlinkElement(int elementIndex)
+{
+    const int quadNodeIndex = this->elementLeaves[elementIndex], previous = this->elementPrevious[elementIndex],
+        next = this->elementNodes.at(elementIndex).next;
+
+    if (previous == ElementNode::NONE)
+        this->quadNodes.at(quadNodeIndex).firstChild = next;
+    else
+        this->elementNodes.at(previous).next = next;
+
+    if (next != ElementNode::NONE)
+        this->elementPrevious[next] = previous;
+
+    this->quadNodes.at(quadNodeIndex).numElements--;
+    this->elementNodes.erase(elementIndex);
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::unlinkColliderElement(int colliderIndex, int elementIndex)
+{
+    int* link = &this->colliderFirstElements[colliderIndex];
+
+    while (*link != elementIndex)
+        link = &this->elementColliderNext[*link];
+
+    *link = this->elementColliderNext[elementIndex];
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::relinkElements()
+{
+    FreeList<int> leafIndices;
+
+    this->colliderFirstElements.assign(this->colliderTops.size(), ElementNode::NONE);
+    this->getAllLeaves(&leafIndices);
+
+    for (int i = 0; i < leafIndices.size(); i++)
+    {
+        int previous = ElementNode::NONE;
+
+        for (int element = this->quadNodes.at(leafIndices.at(i)).firstChild; element != ElementNode::NONE;
+            element = this->elementNodes.at(element).next)
+        {
+            this->linkElement(element, leafIndices.at(i), previous);
+            previous = element;
+        }
+    }
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::finishSubtree(const QuadNodeData<CoordType>& rootData)
+{
+    FreeList<QuadNodeData<CoordType>> toProcess;
+    FreeList<int> preorder;
+
+    if ((int)this->nodeCategories.size() < this->quadNodes.size())
+        this->nodeCategories.resize(this->quadNodes.size());
+
+    toProcess.at(toProcess.pushBack()) = rootData;
+
+    while (toProcess.size())
+    {
+        const QuadNodeData<CoordType> data = toProcess.at(toProcess.size() - 1);
+        const QuadNode& node = this->quadNodes.at(data.quadNodeIndex);
+        const bool isBranch = node.numElements == QuadNode::BRANCH_NODE;
+
+        toProcess.popBack();
+        preorder.at(preorder.pushBack()) = data.quadNodeIndex;
+        this->nodeCategories[data.quadNodeIndex] = 0;
+
+        if (data.depth <= this->gridDepth && (!isBranch || data.depth == this->gridDepth) && this->gridDepth > 0)
+            this->setGridNode(data);
+
+        if (isBranch)
+        {
+            for (int i = 0; i < 4; i++)
+                toProcess.at(toProcess.pushBack()) = childNodeData(data, node.firstChild, i);
+
+            continue;
+        }
+
+        int previous = ElementNode::NONE;
+
+        for (int element = node.firstChild; element != ElementNode::NONE; element = this->elementNodes.at(element).next)
+        {
+            const int colliderIndex = this->elementNodes.at(element).colliderIndex;
+
+            this->linkElement(element, data.quadNodeIndex, previous);
+            this->nodeCategories[data.quadNodeIndex] |= this->colliderCategories[colliderIndex];
+            previous = element;
+        }
+    }
+
+    for (int i = preorder.size() - 1; i >= 0; i--)
+    {
+        const QuadNode& node = this->quadNodes.at(preorder.at(i));
+
+        if (node.numElements == QuadNode::BRANCH_NODE)
+            for (int child = 0; child < 4; child++)
+                this->nodeCategories[preorder.at(i)] |= this->nodeCategories[node.firstChild + child];
+    }
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::recomputeCategories()
+{
+    FreeList<int> toProcess, preorder;
+
+    this->nodeCategories.assign(this->quadNodes.size(), 0);
+    toProcess.at(toProcess.pushBack()) = this->rootNodeIndex;
+
+    while (toProcess.size())
+    {
+        const int quadNodeIndex = toProcess.at(toProcess.size() - 1);
+        const QuadNode& node = this->quadNodes.at(quadNodeIndex);
+
+        toProcess.popBack();
+        preorder.at(preorder.pushBack()) = quadNodeIndex;
+
+        if (node.numElements == QuadNode::BRANCH_NODE)
+        {
+            for (int i = 0; i < 4; i++)
+                toProcess.at(toProcess.pushBack()) = node.firstChild + i;
+        }
+        else for (int element = node.firstChild; element != ElementNode::NONE; element = this->elementNodes.at(element).next)
+            this->nodeCategories[quadNodeIndex] |= this->colliderCategories[this->elementNodes.at(element).colliderIndex];
+    }
+
+    /* Children come after their parents in preorder, so walking it backwards completes them first. */
+    for (int i = preorder.size() - 1; i >= 0; i--)
+    {
+        const QuadNode& node = this->quadNodes.at(preorder.at(i));
+
+        if (node.numElements == QuadNode::BRANCH_NODE)
+            for (int child = 0; child < 4; child++)
+                this->nodeCategories[preorder.at(i)] |= this->nodeCategories[node.firstChild + child];
+    }
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::buildSubtree(FreeList<QuadNode>* nodes, FreeList<ElementNode>* elements, std::vector<int>* partitions,
+    const QuadNodeData<CoordType>& rootData) const
+{
+    /* Each entry refers to a node and the range of the partition buffer holding its collider indices. */
+    struct BuildEntry
+    {
+        QuadNodeData<CoordType> data;
+        int first, count;
+    };
+
+    std::vector<BuildEntry> toProcess;
+    std::vector<int>& buffer = *partitions;
+
+    toProcess.push_back({ rootData, 0, (int)buffer.size() });
+
+    while (toProcess.size())
+    {
+        const BuildEntry entry = toProcess.back();
+        const QuadNodeData<CoordType>& data = entry.data;
+
+        toProcess.pop_back();
+
+        /* Ranges are stacked in the same order as the entries, so anything past this range belongs to
+         * subtrees that have already been built. */
+        buffer.resize(entry.first + entry.count);
+
+        /* Create a leaf whose elements are allocated contiguously and linked in order. */
+        if (entry.count <= this->maxEltsPerNode || data.depth >= this->maxDivisions)
+        {
+            int previous = ElementNode::NONE;
+
+            nodes->at(data.quadNodeIndex).firstChild = ElementNode::NONE;
+            nodes->at(data.quadNodeIndex).numElements = entry.count;
+
+            for (int i = 0; i < entry.count; i++)
+            {
+                const int elementIndex = elements->insert();
+
+                elements->at(elementIndex).colliderIndex = buffer[entry.first + i];
+                elements->at(elementIndex).next = ElementNode::NONE;
+
+                if (previous == ElementNode::NONE)
+                    nodes->at(data.quadNodeIndex).firstChild = elementIndex;
+                else
+                    elements->at(previous).next = elementIndex;
+
+                previous = elementIndex;
+            }
+
+            continue;
+        }
+
+        const int firstChild = nodes->insert();
+
+        nodes->insert();
+        nodes->insert();
+        nodes->insert();
+
+        nodes->at(data.quadNodeIndex).firstChild = firstChild;
+        nodes->at(data.quadNodeIndex).numElements = QuadNode::BRANCH_NODE;
+
+        const CoordType halfX = quadMidpoint(data.left, data.right), halfY = quadMidpoint(data.bottom, data.top);
+
+        const QuadNodeData<CoordType> childDatas[4] = {
+            QuadNodeData<CoordType>(firstChild, data.depth + 1, data.top, halfY, data.left, halfX),
+            QuadNodeData<CoordType>(firstChild + 1, data.depth + 1, data.top, halfY, halfX, data.right),
+            QuadNodeData<CoordType>(firstChild + 2, data.depth + 1, halfY, data.bottom, data.left, halfX),
+            QuadNodeData<CoordType>(firstChild + 3, data.depth + 1, halfY, data.bottom, halfX, data.right)
+        };
+
+        /* Partition in reverse so that the first child's range ends up on top and is built first. */
+        for (int child = 3; child >= 0; child--)
+        {
+            const int childFirst = (int)buffer.size();
+
+            for (int i = 0; i < entry.count; i++)
+            {
+                const int colliderIndex = buffer[entry.first + i];
+                if ((child & 1 ? this->colliderRights[colliderIndex] >= halfX : this->colliderLefts[colliderIndex] < halfX) &&
+                    (child & 2 ? this->colliderBottoms[colliderIndex] < halfY : this->colliderTops[colliderIndex] >= halfY))
+                    buffer.push_back(colliderIndex);
+            }
+
+            toProcess.push_back({ childDatas[child], childFirst, (int)buffer.size() - childFirst });
+        }
+    }
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::buildParallel(std::vector<int>* partitions, int numThreads)
+{
+    /* A node still to be built, with the indices of the colliders it holds. */
+    struct BuildTask
+    {
+        QuadNodeData<CoordType> data;
+        std::vector<int> colliderIndices;
+    };
+
+    /* Several subtrees per thread let uneven subtrees balance across threads. */
+    const int targetTasks = numThreads * 4;
+
+    std::vector<BuildTask> tasks(1);
+
+    tasks[0].data = QuadNodeData<CoordType>(this->rootNodeIndex, 0, this->topBound, this->bottomBound, this->leftBound,
+        this->rightBound);
+    tasks[0].colliderIndices.swap(*partitions);
+
+    /* Split the top of the quadtree one level at a time, directly into the final quadnode list. */
+    while ((int)tasks.size() < targetTasks)
+    {
+        std::vector<BuildTask> next, parents;
+        std::vector<int> childPositions;
+
+        for (BuildTask& task : tasks)
+        {
+            if ((int)task.colliderIndices.size() <= this->maxEltsPerNode || task.data.depth >= this->maxDivisions)
+            {
+                next.push_back(std::move(task));
+                continue;
+            }
+
+            const int firstChild = this->quadNodes.insert();
+
+            this->quadNodes.insert();
+            this->quadNodes.insert();
+            this->quadNodes.insert();
+
+            this->quadNodes.at(task.data.quadNodeIndex).firstChild = firstChild;
+            this->quadNodes.at(task.data.quadNodeIndex).numElements = QuadNode::BRANCH_NODE;
+
+            for (int child = 0; child < 4; child++)
+            {
+                childPositions.push_back((int)next.size());
+                next.emplace_back();
+                next.back().data = childNodeData(task.data, firstChild, child);
+            }
+
+            parents.push_back(std::move(task));
+        }
+
+        /* Partition each split node's colliders into its children. */
+        parallelFor(numThreads, (int)childPositions.size(), [&](int childTask, int)
+        {
+            BuildTask& child = next[childPositions[childTask]];
+            const BuildTask& parent = parents[childTask / 4];
+            const int childNumber = childTask % 4;
+            const CoordType halfX = quadMidpoint(parent.data.left, parent.data.right),
+                halfY = quadMidpoint(parent.data.bottom, parent.data.top);
+
+            for (const int colliderIndex : parent.colliderIndices)
+                if ((childNumber & 1 ? this->colliderRights[colliderIndex] >= halfX : this->colliderLefts[colliderIndex] < halfX) &&
+                    (childNumber & 2 ? this->colliderBottoms[colliderIndex] < halfY : this->colliderTops[colliderIndex] >= halfY))
+                    child.colliderIndices.push_back(colliderIndex);
+        });
+
+        tasks.swap(next);
+
+        if (parents.empty())
+            break;
+    }
+
+    /* Build every subtree into its own lists, rooted at index zero. */
+    const int numTasks = (int)tasks.size();
+
+    std::vector<FreeList<QuadNode>> taskNodes(numTasks);
+    std::vector<FreeList<ElementNode>> taskElements(numTasks);
+
+    parallelFor(numThreads, numTasks, [&](int task, int)
+    {
+        const QuadNodeData<CoordType>& data = tasks[task].data;
+
+        this->buildSubtree(&taskNodes[task], &taskElements[task], &tasks[task].colliderIndices, QuadNodeData<CoordType>(
+            taskNodes[task].insert(), data.depth, data.top, data.bottom, data.left, data.right));
+    });
+
+    /* Reserve a range of each final list per subtree. The subtree roots already have their final quadnodes. */
+    std::vector<int> nodeBases(numTasks), elementBases(numTasks);
+
+    for (int task = 0; task < numTasks; task++)
+    {
+        nodeBases[task] = this->quadNodes.size();
+        elementBases[task] = this->elementNodes.size();
+
+        for (int i = 1; i < taskNodes[task].size(); i++)
+            this->quadNodes.insert();
+        for (int i = 0; i < taskElements[task].size(); i++)
+            this->elementNodes.insert();
+    }
+
+    /* Copy the subtrees into their ranges, rebasing every index. */
+    parallelFor(numThreads, numTasks, [&](int task, int)
+    {
+        const FreeList<QuadNode>& nodes = taskNodes[task];
+        const FreeList<ElementNode>& elements = taskElements[task];
+        const int nodeBase = nodeBases[task], elementBase = elementBases[task];
+
+        for (int i = 0; i < nodes.size(); i++)
+        {
+            QuadNode node = nodes.at(i);
+
+            if (node.numElements == QuadNode::BRANCH_NODE)
+                node.firstChild += nodeBase - 1;
+            else if (node.firstChild != ElementNode::NONE)
+                node.firstChild += elementBase;
+
+            this->quadNodes.at(i == 0 ? tasks[task].data.quadNodeIndex : nodeBase + i - 1) = node;
+        }
+
+        for (int i = 0; i < elements.size(); i++)
+        {
+            ElementNode element = elements.at(i);
+
+            if (element.next != ElementNode::NONE)
+                element.next += elementBase;
+
+            this->elementNodes.at(elementBase + i) = element;
+        }
+    });
+}
+
+template<typename CoordType>
+void QuadTree<CoordType>::subdivideNode(int quadNodeIndex, int depth, CoordType top, CoordType bottom, CoordType left, CoordType right)
+{
+    QUADTREE_COUNT(this->counters.subdivisions, 1);
+
+    /* First, we need to retrieve all the collider indices. */
+    FreeList<int> colliderIndexStack;
+    int currentEltIndex = this->quadNodes.at(quadNodeIndex).firstChild, previous;
+
+    while (currentEltIndex != ElementNode::NONE)
+    {        
+        previous = currentEltIndex;
+
+        const int colliderIndex = this->elementNodes.at(currentEltIndex).colliderIndex;
+
+        colliderIndexStack.at(colliderIndexStack.pushBack()) = colliderIndex;
+        currentEltIndex = this->elementNodes.at(currentEltIndex).next;
+
+        this->unlinkColliderElement(colliderIndex, previous);
+        this->elementNodes.erase(previous);
+    }
+
+    /* Allocate child nodes. */
+    const int newChild = this->quadNodes.insert();
+
+    this->quadNodes.insert();
+    this->quadNodes.insert();
+    this->quadNodes.insert();
+    
+    if ((int)this->nodeCategories.size() < this->quadNodes.size())
+        this->nodeCategories.resize(this->quadNodes.size());
+
+    /* Set all child nodes as empty. */
+    for (size_t i = 0; i < 4; i++)
+    {
+        this->quadNodes.at(newChild + i).firstChild = ElementNode::NONE;
+        this->quadNodes.at(newChild + i).numElements = 0;
+        this->nodeCategories[newChild + i] = 0;
+    }
+
+    /* Now assign the quadnode's new values. */
+    this->quadNodes.at(quadNodeIndex).numElements = QuadNode::BRANCH_NODE;
+    this->quadNodes.at(quadNodeIndex).firstChild = newChild;
+
+    /* Point the grid cells covered by the node at its children. */
+    if (depth < this->gridDepth)
+    {
+        const QuadNodeData<CoordType> data(quadNodeIndex, depth, top, bottom, left, right);
+
+        for (int i = 0; i < 4; i++)
+            this->setGridNode(childNodeData(data, newChild, i));
+    }
+
+    FreeList<QuadNodeData<CoordType>> leavesForInsertion;
+
+    const int numColliders = colliderIndexStack.size();
+
+    for (int i = 0; i < numColliders; i++)
+    {
+        const int colliderIndex = colliderIndexStack.at(i);
+
+        this->getLeaves(&leavesForInsertion, this->colliderTops[colliderIndex], this->colliderBottoms[colliderIndex],
+            this->colliderLefts[colliderIndex], this->colliderRights[colliderIndex], quadNodeIndex, depth, top, bottom,
+            left, right, this->colliderCategories[colliderIndex]);
+        const int numLeaves = leavesForInsertion.size();
+
+        /* Insert the collider pointer into the leaf at the given leaf. */
+        for (int j = 0; j < numLeaves; j++)
+            this->nodeInsert(colliderIndex, leavesForInsertion.at(j));
+
+        leavesForInsertion.clear();
+    }
+}
+
+#endif
\ No newline at end of file
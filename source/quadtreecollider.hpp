@@ -1,15 +1,30 @@
 #ifndef QUAD_COLLIDER_HPP_INCLUDED
 #define QUAD_COLLIDER_HPP_INCLUDED
 
+template<typename CoordType = int>
 struct QuadTreeCollider
 {
     QuadTreeCollider();
-    QuadTreeCollider(int top, int bottom, int left, int right);
+    QuadTreeCollider(CoordType top, CoordType bottom, CoordType left, CoordType right);
 
     const bool operator ==(const QuadTreeCollider& other) const;
     const bool operator !=(const QuadTreeCollider& other) const;
 
-    int top, bottom, left, right;
+    CoordType top, bottom, left, right;
 };
 
+template<typename CoordType = int>
+struct QuadTreePoint
+{
+    QuadTreePoint();
+    QuadTreePoint(CoordType x, CoordType y);
+
+    bool operator ==(const QuadTreePoint& other) const;
+    bool operator !=(const QuadTreePoint& other) const;
+
+    CoordType x, y;
+};
+
+#include "quadtreecollider.inl"
+
 #endif
\ No newline at end of file
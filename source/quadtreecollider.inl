@@ -0,0 +1,55 @@
+#ifndef QUAD_COLLIDER_INL_INCLUDED
+#define QUAD_COLLIDER_INL_INCLUDED
+
+template<typename CoordType>
+QuadTreeCollider<CoordType>::QuadTreeCollider()
+    : top(0), bottom(0), left(0), right(0)
+{
+}
+
+template<typename CoordType>
+QuadTreeCollider<CoordType>::QuadTreeCollider(CoordType top, CoordType bottom, CoordType left, CoordType right)
+    : top(top), bottom(bottom), left(left), right(right)
+{
+}
+
+template<typename CoordType>
+const bool QuadTreeCollider<CoordType>::operator ==(const QuadTreeCollider& other) const
+{
+    return this->top == other.top &&
+           this->bottom == other.bottom &&
+           this->left == other.left &&
+           this->right == other.right;
+}
+
+template<typename CoordType>
+const bool QuadTreeCollider<CoordType>::operator !=(const QuadTreeCollider& other) const
+{
+    return !(*this == other);
+}
+
+template<typename CoordType>
+QuadTreePoint<CoordType>::QuadTreePoint()
+    : x(0), y(0)
+{
+}
+
+template<typename CoordType>
+QuadTreePoint<CoordType>::QuadTreePoint(CoordType x, CoordType y)
+    : x(x), y(y)
+{
+}
+
+template<typename CoordType>
+bool QuadTreePoint<CoordType>::operator ==(const QuadTreePoint& other) const
+{
+    return this->x == other.x && this->y == other.y;
+}
+
+template<typename CoordType>
+bool QuadTreePoint<CoordType>::operator !=(const QuadTreePoint& other) const
+{
+    return !(*this == other);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef QUADTREE_PUBLISHER_HPP_INCLUDED
+#define QUADTREE_PUBLISHER_HPP_INCLUDED
+
+#include <memory>
+
+#include "quadtree.hpp"
+
+/* Lets one writer thread modify a quadtree while any number of reader threads query consistent, immutable copies
+ * of it. The writer applies its changes to a back buffer and publishes a copy when they are ready. Readers acquire
+ * the latest published copy, which stays alive for as long as they hold it, and query it without synchronising
+ * with the writer. */
+template<typename CoordType = int>
+class QuadTreePublisher
+{
+public:
+    QuadTreePublisher(CoordType top, CoordType bottom, CoordType left, CoordType right, int maxDivisions,
+        int maxEltsPerNode);
+
+    /* Returns the quadtree the writer modifies. Only the writer thread may use it. */
+    QuadTree<CoordType>& getBackBuffer();
+
+    /* Copies the back buffer and atomically replaces the published quadtree with the copy. The copy is made
+     * into the quadtree published before the current one once every reader has released it, reusing each list
+     * and array whose size has not changed. Only the writer thread may call this. */
+    void publish();
+
+    /* Returns the most recently published quadtree. It is never modified, so readers query it through the const
+     * overloads, each with its own QueryContext. Safe to call from any thread. The pointer is loaded with
+     * std::atomic_load, which is not lock-free in common standard libraries, but the lock is only held for the
+     * copy of the pointer. */
+    std::shared_ptr<const QuadTree<CoordType>> acquire() const;
+
+#ifndef NO_PRIVATE
+    private:
+#endif
+    QuadTree<CoordType> backBuffer;
+
+    /* The quadtree returned by acquire. Only accessed through the atomic shared_ptr functions. */
+    std::shared_ptr<const QuadTree<CoordType>> published;
+
+    /* The previously published quadtree, recycled by the next publish if no reader still holds it. */
+    std::shared_ptr<QuadTree<CoordType>> retired;
+};
+
+#include "quadtreepublisher.inl"
+
+#endif
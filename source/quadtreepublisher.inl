@@ -0,0 +1,49 @@
+#ifndef QUADTREE_PUBLISHER_INL_INCLUDED
+#define QUADTREE_PUBLISHER_INL_INCLUDED
+
+#include <atomic>
+
+template<typename CoordType>
+QuadTreePublisher<CoordType>::QuadTreePublisher(CoordType top, CoordType bottom, CoordType left, CoordType right,
+    int maxDivisions, int maxEltsPerNode)
+    : backBuffer(top, bottom, left, right, maxDivisions, maxEltsPerNode),
+      published(std::make_shared<const QuadTree<CoordType>>(backBuffer))
+{
+}
+
+template<typename CoordType>
+QuadTree<CoordType>& QuadTreePublisher<CoordType>::getBackBuffer()
+{
+    return this->backBuffer;
+}
+
+template<typename CoordType>
+void QuadTreePublisher<CoordType>::publish()
+{
+    std::shared_ptr<QuadTree<CoordType>> next;
+
+    /* The retired quadtree can no longer be acquired, so once its count drops to one it never rises again. The
+     * fence orders the last reader's accesses before the copy overwrites it. */
+    if (this->retired && this->retired.use_count() == 1)
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        next = std::move(this->retired);
+        *next = this->backBuffer;
+    }
+    else
+        next = std::make_shared<QuadTree<CoordType>>(this->backBuffer);
+
+    const std::shared_ptr<const QuadTree<CoordType>> previous =
+        std::atomic_exchange(&this->published, std::shared_ptr<const QuadTree<CoordType>>(next));
+
+    this->retired = std::const_pointer_cast<QuadTree<CoordType>>(previous);
+}
+
+template<typename CoordType>
+std::shared_ptr<const QuadTree<CoordType>> QuadTreePublisher<CoordType>::acquire() const
+{
+    return std::atomic_load(&this->published);
+}
+
+#endif
@@ -0,0 +1,105 @@
+#include "quadtreesnapshot.hpp"
+
+#include <cstdio>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define QUADTREE_SNAPSHOT_MMAP
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+    : mappedData(nullptr), mappedSize(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    this->close();
+}
+
+bool MappedFile::open(const char* path)
+{
+    this->close();
+
+#ifdef QUADTREE_SNAPSHOT_MMAP
+    const int descriptor = ::open(path, O_RDONLY);
+
+    if (descriptor < 0)
+        return false;
+
+    struct stat status;
+
+    if (fstat(descriptor, &status) != 0 || status.st_size <= 0)
+    {
+        ::close(descriptor);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, (std::size_t)status.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+
+    /* The mapping stays valid after the descriptor is closed. */
+    ::close(descriptor);
+
+    if (mapping == MAP_FAILED)
+        return false;
+
+    this->mappedData = (const unsigned char*)mapping;
+    this->mappedSize = (std::size_t)status.st_size;
+#else
+    std::FILE* file = std::fopen(path, "rb");
+
+    if (!file)
+        return false;
+
+    bool succeeded = std::fseek(file, 0, SEEK_END) == 0;
+    const long fileSize = succeeded ? std::ftell(file) : -1;
+
+    succeeded = fileSize > 0 && std::fseek(file, 0, SEEK_SET) == 0;
+
+    if (succeeded)
+    {
+        this->buffer.resize((std::size_t)fileSize);
+        succeeded = std::fread(this->buffer.data(), 1, this->buffer.size(), file) == this->buffer.size();
+    }
+
+    std::fclose(file);
+
+    if (!succeeded)
+    {
+        this->buffer.clear();
+        return false;
+    }
+
+    this->mappedData = this->buffer.data();
+    this->mappedSize = this->buffer.size();
+#endif
+
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifdef QUADTREE_SNAPSHOT_MMAP
+    if (this->mappedData)
+        munmap((void*)this->mappedData, this->mappedSize);
+#else
+    this->buffer.clear();
+    this->buffer.shrink_to_fit();
+#endif
+
+    this->mappedData = nullptr;
+    this->mappedSize = 0;
+}
+
+const unsigned char* MappedFile::data() const
+{
+    return this->mappedData;
+}
+
+std::size_t MappedFile::size() const
+{
+    return this->mappedSize;
+}
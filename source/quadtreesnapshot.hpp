@@ -0,0 +1,101 @@
+#ifndef QUADTREE_SNAPSHOT_HPP_INCLUDED
+#define QUADTREE_SNAPSHOT_HPP_INCLUDED
+
+#include <cstddef>
+#include <vector>
+
+#include "quadtree.hpp"
+
+/* A read-only view of a whole file. The file is memory mapped where the platform supports it, so that
+ * processes mapping the same file share its pages, and read into memory otherwise. */
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /* Maps the file, closing any file mapped before. Returns false if it could not be mapped. */
+    bool open(const char* path);
+
+    /* Unmaps the file. */
+    void close();
+
+    const unsigned char* data() const;
+    std::size_t size() const;
+
+#ifndef NO_PRIVATE
+    private:
+#endif
+    const unsigned char* mappedData;
+    std::size_t mappedSize;
+
+    /* Holds the file contents on platforms without memory mapping. */
+    std::vector<unsigned char> buffer;
+};
+
+/* Serves queries straight from a snapshot written by QuadTree::saveSnapshot, without rebuilding or copying the
+ * quadtree. Colliders are identified by the collider indices they had in the saved quadtree. */
+template<typename CoordType = int>
+class QuadTreeSnapshot
+{
+public:
+    QuadTreeSnapshot();
+
+    /* Maps the snapshot file. Returns false if it cannot be read, was written by another version, for another
+     * coordinate type or with another byte order, or if its nodes index outside its arrays or loop back on
+     * themselves. */
+    bool open(const char* path);
+
+    /* Unmaps the snapshot file. */
+    void close();
+
+    /* Returns whether a snapshot is mapped. */
+    bool isOpen() const;
+
+    /* Returns the number of collider indices in the snapshot, including vacant ones. */
+    int getNumColliders() const;
+
+    /* Returns the boundaries the collider had when the snapshot was saved. */
+    QuadTreeCollider<CoordType> getColliderBounds(int colliderIndex) const;
+
+    /* Populates the freelist with the indices of the colliders inside the boundaries. */
+    void query(FreeList<int>* output, CoordType top, CoordType bottom, CoordType left, CoordType right);
+
+    /* As above, using the given context as scratch space. Safe to call from several threads. */
+    void query(QueryContext<CoordType>* context, FreeList<int>* output, CoordType top, CoordType bottom, CoordType left,
+        CoordType right) const;
+
+    /* Calls the visitor with the index of every collider inside the boundaries. The visitor returns false to stop
+     * the query early, in which case false is returned. */
+    template<typename Visitor>
+    bool queryVisit(QueryContext<CoordType>* context, CoordType top, CoordType bottom, CoordType left, CoordType right,
+        Visitor visitor) const;
+
+#ifndef NO_PRIVATE
+    private:
+#endif
+    MappedFile file;
+
+    /* The arrays within the mapping. */
+    const QuadNode* quadNodes;
+    const ElementNode* elementNodes;
+    const CoordType *colliderTops, *colliderBottoms, *colliderLefts, *colliderRights;
+
+    CoordType topBound, bottomBound, leftBound, rightBound;
+
+    int rootNodeIndex, numQuadNodes, numElementNodes, numColliders;
+
+    /* Scratch space for the non-const query. */
+    QueryContext<CoordType> queryContext;
+
+    /* Returns whether every node and element node reachable from the root indexes within the mapped arrays. Each
+     * is visited at most once in a valid snapshot, so visiting more than the arrays hold means a loop. */
+    bool validateNodes() const;
+};
+
+#include "quadtreesnapshot.inl"
+
+#endif
@@ -0,0 +1,251 @@
+#ifndef QUADTREE_SNAPSHOT_INL_INCLUDED
+#define QUADTREE_SNAPSHOT_INL_INCLUDED
+
+#include <cstring>
+
+template<typename CoordType>
+QuadTreeSnapshot<CoordType>::QuadTreeSnapshot()
+    : quadNodes(nullptr), elementNodes(nullptr), colliderTops(nullptr), colliderBottoms(nullptr), colliderLefts(nullptr),
+      colliderRights(nullptr), topBound(0), bottomBound(0), leftBound(0), rightBound(0), rootNodeIndex(0),
+      numQuadNodes(0), numElementNodes(0), numColliders(0), queryContext()
+{
+}
+
+template<typename CoordType>
+bool QuadTreeSnapshot<CoordType>::open(const char* path)
+{
+    this->close();
+
+    if (!this->file.open(path) || this->file.size() < sizeof(SnapshotHeader))
+    {
+        this->file.close();
+        return false;
+    }
+
+    SnapshotHeader header;
+
+    std::memcpy(&header, this->file.data(), sizeof(SnapshotHeader));
+
+    const auto arrayFits = [&](std::uint64_t offset, std::uint64_t numBytes)
+    {
+        return offset % SnapshotHeader::ALIGNMENT == 0 && offset <= header.fileSize && numBytes <= header.fileSize - offset;
+    };
+
+    /* Reject files this build cannot read in place. */
+    if (header.magic != SnapshotHeader::MAGIC || header.version != SnapshotHeader::VERSION ||
+        header.byteOrder != SnapshotHeader::BYTE_ORDER_MARK || header.coordinateType != snapshotCoordinateType<CoordType>() ||
+        header.fileSize != this->file.size() || header.numQuadNodes <= header.rootNodeIndex || header.rootNodeIndex < 0 ||
+        header.numElementNodes < 0 || header.numColliders < 0 ||
+        !arrayFits(header.quadNodesOffset, (std::uint64_t)header.numQuadNodes * sizeof(QuadNode)) ||
+        !arrayFits(header.elementNodesOffset, (std::uint64_t)header.numElementNodes * sizeof(ElementNode)) ||
+        !arrayFits(header.boundsOffset, (4 + 4 * (std::uint64_t)header.numColliders) * sizeof(CoordType)))
+    {
+        this->file.close();
+        return false;
+    }
+
+    const unsigned char* data = this->file.data();
+    const CoordType* bounds = (const CoordType*)(data + header.boundsOffset);
+
+    this->quadNodes = (const QuadNode*)(data + header.quadNodesOffset);
+    this->elementNodes = (const ElementNode*)(data + header.elementNodesOffset);
+
+    this->topBound = bounds[0];
+    this->bottomBound = bounds[1];
+    this->leftBound = bounds[2];
+    this->rightBound = bounds[3];
+
+    this->colliderTops = bounds + 4;
+    this->colliderBottoms = this->colliderTops + header.numColliders;
+    this->colliderLefts = this->colliderBottoms + header.numColliders;
+    this->colliderRights = this->colliderLefts + header.numColliders;
+
+    this->rootNodeIndex = header.rootNodeIndex;
+    this->numQuadNodes = header.numQuadNodes;
+    this->numElementNodes = header.numElementNodes;
+    this->numColliders = header.numColliders;
+
+    /* The contents are checked once here, so that queries can index the arrays without checks. */
+    if (!this->validateNodes())
+    {
+        this->close();
+        return false;
+    }
+
+    return true;
+}
+
+template<typename CoordType>
+void QuadTreeSnapshot<CoordType>::close()
+{
+    this->file.close();
+
+    this->quadNodes = nullptr;
+    this->elementNodes = nullptr;
+    this->colliderTops = this->colliderBottoms = this->colliderLefts = this->colliderRights = nullptr;
+    this->numQuadNodes = this->numElementNodes = this->numColliders = 0;
+}
+
+template<typename CoordType>
+bool QuadTreeSnapshot<CoordType>::validateNodes() const
+{
+    FreeList<int> toProcess;
+    int numNodesVisited = 0, numElementsVisited = 0;
+
+    toProcess.at(toProcess.pushBack()) = this->rootNodeIndex;
+
+    while (toProcess.size())
+    {
+        const QuadNode& node = this->quadNodes[toProcess.at(toProcess.size() - 1)];
+
+        toProcess.popBack();
+
+        if (++numNodesVisited > this->numQuadNodes)
+            return false;
+
+        if (node.numElements == QuadNode::BRANCH_NODE)
+        {
+            if (node.firstChild < 0 || node.firstChild > this->numQuadNodes - 4)
+                return false;
+
+            for (int i = 0; i < 4; i++)
+                toProcess.at(toProcess.pushBack()) = node.firstChild + i;
+
+            continue;
+        }
+
+        for (int element = node.firstChild; element != ElementNode::NONE; element = this->elementNodes[element].next)
+        {
+            if (element < 0 || element >= this->numElementNodes || ++numElementsVisited > this->numElementNodes)
+                return false;
+
+            const int colliderIndex = this->elementNodes[element].colliderIndex;
+
+            if (colliderIndex < 0 || colliderIndex >= this->numColliders)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+template<typename CoordType>
+bool QuadTreeSnapshot<CoordType>::isOpen() const
+{
+    return this->quadNodes != nullptr;
+}
+
+template<typename CoordType>
+int QuadTreeSnapshot<CoordType>::getNumColliders() const
+{
+    return this->numColliders;
+}
+
+template<typename CoordType>
+QuadTreeCollider<CoordType> QuadTreeSnapshot<CoordType>::getColliderBounds(int colliderIndex) const
+{
+    assert(colliderIndex >= 0 && colliderIndex < this->numColliders);
+
+    return QuadTreeCollider<CoordType>(this->colliderTops[colliderIndex], this->colliderBottoms[colliderIndex],
+        this->colliderLefts[colliderIndex], this->colliderRights[colliderIndex]);
+}
+
+template<typename CoordType>
+void QuadTreeSnapshot<CoordType>::query(FreeList<int>* output, CoordType top, CoordType bottom, CoordType left,
+    CoordType right)
+{
+    this->query(&this->queryContext, output, top, bottom, left, right);
+}
+
+template<typename CoordType>
+void QuadTreeSnapshot<CoordType>::query(QueryContext<CoordType>* context, FreeList<int>* output, CoordType top,
+    CoordType bottom, CoordType left, CoordType right) const
+{
+    this->queryVisit(context, top, bottom, left, right, [output](int colliderIndex)
+    {
+        output->at(output->pushBack()) = colliderIndex;
+        return true;
+    });
+}
+
+template<typename CoordType>
+template<typename Visitor>
+bool QuadTreeSnapshot<CoordType>::queryVisit(QueryContext<CoordType>* context, CoordType top, CoordType bottom,
+    CoordType left, CoordType right, Visitor visitor) const
+{
+    assert(this->isOpen());
+
+    /* Return early if the boundaries do not overlap the quadtree. */
+    if (this->topBound <= bottom || this->bottomBound > top || this->rightBound <= left || this->leftBound > right)
+        return true;
+
+    FreeList<QuadNodeData<CoordType>>& processingStack = context->processingStack;
+    std::vector<unsigned int>& queryStamps = context->queryStamps;
+    const unsigned int stamp = context->nextStamp(this->numColliders);
+
+    processingStack.clear();
+
+    pushBackNode(&processingStack, this->rootNodeIndex, 0, this->topBound, this->bottomBound, this->leftBound, this->rightBound);
+
+    /* The same descent as QuadTree::queryVisit, over the mapped arrays. */
+    while (processingStack.size() > 0)
+    {
+        const QuadNodeData<CoordType> data = processingStack.at(processingStack.size() - 1);
+        const QuadNode& node = this->quadNodes[data.quadNodeIndex];
+
+        processingStack.popBack();
+        QUADTREE_COUNT(context->counters.nodesVisited, 1);
+
+        if (node.numElements == QuadNode::BRANCH_NODE)
+        {
+            const CoordType halfX = quadMidpoint(data.left, data.right), halfY = quadMidpoint(data.bottom, data.top);
+
+            if (left < halfX)
+            {
+                /* Top left. */
+                if (top >= halfY)
+                    pushBackNode(&processingStack, node.firstChild, data.depth + 1, data.top, halfY, data.left, halfX);
+                /* Bottom left. */
+                if (bottom < halfY)
+                    pushBackNode(&processingStack, node.firstChild + 2, data.depth + 1, halfY, data.bottom, data.left, halfX);
+            }
+            if (right >= halfX)
+            {
+                /* Top right. */
+                if (top >= halfY)
+                    pushBackNode(&processingStack, node.firstChild + 1, data.depth + 1, data.top, halfY, halfX, data.right);
+                /* Bottom right. */
+                if (bottom < halfY)
+                    pushBackNode(&processingStack, node.firstChild + 3, data.depth + 1, halfY, data.bottom, halfX, data.right);
+            }
+
+            continue;
+        }
+
+        for (int element = node.firstChild; element != ElementNode::NONE; element = this->elementNodes[element].next)
+        {
+            const int colliderIndex = this->elementNodes[element].colliderIndex;
+
+            if (queryStamps[colliderIndex] == stamp)
+            {
+                QUADTREE_COUNT(context->counters.duplicatesRejected, 1);
+                continue;
+            }
+
+            QUADTREE_COUNT(context->counters.elementsTested, 1);
+
+            if (overlaps(this->colliderTops[colliderIndex], this->colliderBottoms[colliderIndex],
+                this->colliderLefts[colliderIndex], this->colliderRights[colliderIndex], top, bottom, left, right))
+            {
+                queryStamps[colliderIndex] = stamp;
+
+                if (!visitor(colliderIndex))
+                    return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+#endif